@@ -0,0 +1,92 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+constexpr auto operation_count = 1000;
+
+struct bench_vector {
+  float x;
+  float y;
+  float z;
+};
+
+struct bench_entity {
+  int id;
+  double health;
+  float speed;
+};
+} // namespace
+
+template <>
+inline constexpr bool maan::aggregate::named_fields<bench_entity> = true;
+
+TEST_CASE("aggregate push and get", "[aggregates]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* state = vm.get_state();
+  const auto vector = bench_vector{1.f, 2.f, 3.f};
+
+  BENCHMARK("maan flat aggregate") {
+    auto sum = 0.f;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(vector);
+      sum += vm.get<bench_vector>(-3).z;
+      vm.pop(3);
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api flat aggregate") {
+    auto sum = 0.f;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushnumber(state, vector.x);
+      lua_pushnumber(state, vector.y);
+      lua_pushnumber(state, vector.z);
+
+      const auto result = bench_vector{static_cast<float>(lua_tonumber(state, -3)), static_cast<float>(lua_tonumber(state, -2)),
+                                       static_cast<float>(lua_tonumber(state, -1))};
+      sum += result.z;
+      lua_settop(state, -4);
+    }
+    return sum;
+  };
+
+  const auto entity = bench_entity{7, 100., 1.5f};
+
+  BENCHMARK("maan named aggregate") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(entity);
+      sum += vm.get<bench_entity>(-1).health;
+      vm.pop();
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api named aggregate") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_createtable(state, 0, 3);
+      lua_pushinteger(state, entity.id);
+      lua_setfield(state, -2, "id");
+      lua_pushnumber(state, entity.health);
+      lua_setfield(state, -2, "health");
+      lua_pushnumber(state, entity.speed);
+      lua_setfield(state, -2, "speed");
+
+      auto result = bench_entity{};
+      lua_getfield(state, -1, "id");
+      result.id = static_cast<int>(lua_tointeger(state, -1));
+      lua_getfield(state, -2, "health");
+      result.health = lua_tonumber(state, -1);
+      lua_getfield(state, -3, "speed");
+      result.speed = static_cast<float>(lua_tonumber(state, -1));
+
+      sum += result.health;
+      lua_settop(state, -5);
+    }
+    return sum;
+  };
+}
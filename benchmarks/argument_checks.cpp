@@ -0,0 +1,26 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+#include "common.hpp"
+
+TEST_CASE("argument check policies per call", "[functions]") {
+  using maan::native_function::argument_check;
+  static constexpr auto iterations = 100000;
+
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push<argument_check::checked>(+[](double value, double factor) -> double { return value * factor; });
+  const auto checked = benchmarks::make_loop(vm);
+  vm.push<argument_check::unchecked>(+[](double value, double factor) -> double { return value * factor; });
+  const auto unchecked = benchmarks::make_loop(vm);
+
+  BENCHMARK("checked") {
+    return benchmarks::run_loop(vm, checked, iterations);
+  };
+
+  BENCHMARK("unchecked") {
+    return benchmarks::run_loop(vm, unchecked, iterations);
+  };
+}
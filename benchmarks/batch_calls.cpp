@@ -0,0 +1,33 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("calling one function over many inputs", "[functions]") {
+  static constexpr auto input_count = 100000;
+
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return function(value) return value * 0.5 + 1 end") == 1);
+  const auto fn = vm.get<maan::function>(-1);
+
+  auto inputs = std::vector<double>(input_count);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i] = static_cast<double>(i);
+  }
+  auto outputs = std::vector<double>(input_count);
+
+  BENCHMARK("call") {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      (void)fn.call<1>(inputs[i]);
+      outputs[i] = vm.get<double>(-1);
+      vm.pop();
+    }
+    return outputs.back();
+  };
+
+  BENCHMARK("call_batch") {
+    (void)fn.call_batch(std::span{inputs}, std::span{outputs});
+    return outputs.back();
+  };
+}
@@ -0,0 +1,67 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+#include "common.hpp"
+
+namespace {
+constexpr auto operation_count = 1000;
+
+int raw_add(lua_State* state) {
+  lua_pushnumber(state, lua_tonumber(state, 1) + lua_tonumber(state, 2));
+  return 1;
+}
+} // namespace
+
+TEST_CASE("native function calls", "[calls]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* state = vm.get_state();
+
+  vm.push(+[](double a, double b) -> double { return a + b; });
+  const auto wrapped = benchmarks::make_loop(vm);
+  lua_pushcclosure(state, raw_add, 0);
+  const auto raw = benchmarks::make_loop(vm);
+
+  BENCHMARK("maan call_wrapper") {
+    return benchmarks::run_loop(vm, wrapped, operation_count);
+  };
+
+  BENCHMARK("c api lua_CFunction") {
+    return benchmarks::run_loop(vm, raw, operation_count);
+  };
+}
+
+TEST_CASE("lua function round trips", "[calls]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* state = vm.get_state();
+
+  REQUIRE(vm.execute("code", "return function(a, b) return a + b end") == 1);
+  const auto fn = vm.get<maan::function>(-1);
+
+  BENCHMARK("maan function::call") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      (void)fn.call<1>(i, 0.5);
+      sum += vm.get<double>(-1);
+      vm.pop();
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api lua_pcall") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushvalue(state, fn.get_location());
+      lua_pushinteger(state, i);
+      lua_pushnumber(state, 0.5);
+      (void)lua_pcall(state, 2, 1, 0);
+      sum += lua_tonumber(state, -1);
+      lua_settop(state, -2);
+    }
+    return sum;
+  };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <maan.hpp>
+
+namespace benchmarks {
+// sums fn(i, 0.5) for i = 1, n, so every iteration crosses from lua into the function under test
+inline constexpr auto loop_code = R"(
+local fn = ...
+return function(n)
+  local sum = 0
+  for i = 1, n do
+    sum = sum + fn(i, 0.5)
+  end
+  return sum
+end
+)";
+
+// pops the function on top of the stack and leaves the loop calling it in its place
+inline maan::function make_loop(maan::vm const& vm) {
+  auto* state = vm.get_state();
+
+  (void)vm.load("loop", loop_code);
+  lua_insert(state, -2);
+  lua_call(state, 1, 1);
+  return vm.get<maan::function>(-1);
+}
+
+inline double run_loop(maan::vm const& vm, maan::function const& loop, int const n) {
+  (void)loop.call(n);
+  const auto result = vm.get<double>(-1);
+  vm.pop();
+  return result;
+}
+} // namespace benchmarks
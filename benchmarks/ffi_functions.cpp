@@ -0,0 +1,31 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+#include "common.hpp"
+
+namespace {
+double scale(double value, double factor) {
+  return value * factor;
+}
+} // namespace
+
+TEST_CASE("native function calls in a loop", "[ffi]") {
+  static constexpr auto iterations = 100000;
+
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(&scale);
+  const auto wrapped = benchmarks::make_loop(vm);
+  REQUIRE(maan::ffi::push_function(vm.get_state(), &scale) == true);
+  const auto direct = benchmarks::make_loop(vm);
+
+  BENCHMARK("call_wrapper") {
+    return benchmarks::run_loop(vm, wrapped, iterations);
+  };
+
+  BENCHMARK("ffi") {
+    return benchmarks::run_loop(vm, direct, iterations);
+  };
+}
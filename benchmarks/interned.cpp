@@ -0,0 +1,68 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+constexpr auto operation_count = 1000;
+} // namespace
+
+TEST_CASE("interned strings", "[interned]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* state = vm.get_state();
+
+  BENCHMARK("maan interned") {
+    for (auto i = 0; i < operation_count; ++i) {
+      maan::interned<"position_x">::push(state);
+      lua_settop(state, -2);
+    }
+    return lua_gettop(state);
+  };
+
+  BENCHMARK("maan key_cache") {
+    const auto keys = maan::key_cache(state);
+    for (auto i = 0; i < operation_count; ++i) {
+      keys.push<"position_x">();
+      lua_settop(state, -2);
+    }
+    return lua_gettop(state);
+  };
+
+  BENCHMARK("c api lua_pushlstring") {
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushlstring(state, "position_x", 10);
+      lua_settop(state, -2);
+    }
+    return lua_gettop(state);
+  };
+
+  BENCHMARK("c api lua_pushstring") {
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushstring(state, "position_x");
+      lua_settop(state, -2);
+    }
+    return lua_gettop(state);
+  };
+}
+
+TEST_CASE("interned table keys", "[interned]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  const auto table = maan::table(vm.get_state(), 0, 1);
+
+  BENCHMARK("maan interned key") {
+    for (auto i = 0; i < operation_count; ++i) {
+      table.set(maan::interned<"position_x">{}, i);
+    }
+    return table.get_view().location;
+  };
+
+  BENCHMARK("maan string key") {
+    for (auto i = 0; i < operation_count; ++i) {
+      table.set("position_x", i);
+    }
+    return table.get_view().location;
+  };
+}
@@ -0,0 +1,71 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+constexpr auto operation_count = 1000;
+} // namespace
+
+TEST_CASE("table set and map", "[tables]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* state = vm.get_state();
+
+  const auto table = maan::table(state, operation_count, 1);
+  const auto location = table.get_view().location;
+
+  BENCHMARK("maan set index") {
+    for (auto i = 0; i < operation_count; ++i) {
+      table.set(i + 1, i);
+    }
+    return location;
+  };
+
+  BENCHMARK("c api set index") {
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushinteger(state, i);
+      lua_rawseti(state, location, i + 1);
+    }
+    return location;
+  };
+
+  BENCHMARK("maan set field") {
+    for (auto i = 0; i < operation_count; ++i) {
+      table.set("field", i);
+    }
+    return location;
+  };
+
+  BENCHMARK("c api set field") {
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushstring(state, "field");
+      lua_pushinteger(state, i);
+      lua_rawset(state, location);
+    }
+    return location;
+  };
+
+  BENCHMARK("maan map field") {
+    int64_t sum = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      (void)table.map<int>("field", [&sum](int const value) {
+        sum += value;
+        return true;
+      });
+      vm.pop();
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api get field") {
+    int64_t sum = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushstring(state, "field");
+      lua_rawget(state, location);
+      sum += static_cast<int>(lua_tointeger(state, -1));
+      lua_settop(state, -2);
+    }
+    return sum;
+  };
+}
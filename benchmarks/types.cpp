@@ -0,0 +1,194 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+constexpr auto operation_count = 1000;
+
+struct bench_object {
+  int value;
+};
+
+struct bench_value {
+  double x;
+  double y;
+};
+} // namespace
+
+template <>
+inline constexpr bool maan::vm_types::by_value<bench_value> = true;
+
+TEST_CASE("vm_types push and get", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* state = vm.get_state();
+
+  BENCHMARK("maan integer") {
+    int64_t sum = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(i);
+      sum += vm.get<int>(-1);
+      vm.pop();
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api integer") {
+    int64_t sum = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushinteger(state, i);
+      sum += static_cast<int>(lua_tointeger(state, -1));
+      lua_settop(state, -2);
+    }
+    return sum;
+  };
+
+  BENCHMARK("maan number") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(i * 0.5);
+      sum += vm.get<double>(-1);
+      vm.pop();
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api number") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushnumber(state, i * 0.5);
+      sum += lua_tonumber(state, -1);
+      lua_settop(state, -2);
+    }
+    return sum;
+  };
+
+  BENCHMARK("maan boolean") {
+    auto count = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push((i & 1) == 0);
+      count += vm.get<bool>(-1) ? 1 : 0;
+      vm.pop();
+    }
+    return count;
+  };
+
+  BENCHMARK("c api boolean") {
+    auto count = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushboolean(state, (i & 1) == 0);
+      count += lua_toboolean(state, -1) != 0 ? 1 : 0;
+      lua_settop(state, -2);
+    }
+    return count;
+  };
+
+  BENCHMARK("maan string") {
+    size_t size = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(std::string_view{"benchmark"});
+      size += vm.get<std::string_view>(-1).size();
+      vm.pop();
+    }
+    return size;
+  };
+
+  BENCHMARK("c api string") {
+    size_t size = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_pushlstring(state, "benchmark", 9);
+      size_t length = 0;
+      (void)lua_tolstring(state, -1, &length);
+      size += length;
+      lua_settop(state, -2);
+    }
+    return size;
+  };
+
+  auto object = bench_object{1};
+
+  BENCHMARK("maan pointer") {
+    auto sum = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(&object);
+      sum += vm.get<bench_object*>(-1)->value;
+      vm.pop();
+    }
+    return sum;
+  };
+
+  BENCHMARK("c api pointer") {
+    auto sum = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      *static_cast<bench_object**>(lua_newuserdata(state, sizeof(bench_object*))) = &object;
+      sum += (*static_cast<bench_object**>(lua_touserdata(state, -1)))->value;
+      lua_settop(state, -2);
+    }
+    return sum;
+  };
+
+  BENCHMARK("maan by value") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(bench_value{1., 2.});
+      sum += vm.get<bench_value>(-1).y;
+      vm.pop();
+    }
+    return sum;
+  };
+
+  // the equivalent of a usertype: a userdata holding the value with a metatable kept in the registry
+  lua_createtable(state, 0, 1);
+  const auto metatable = luaL_ref(state, LUA_REGISTRYINDEX);
+
+  BENCHMARK("c api by value") {
+    auto sum = 0.;
+    for (auto i = 0; i < operation_count; ++i) {
+      new (lua_newuserdata(state, sizeof(bench_value))) bench_value{1., 2.};
+      lua_rawgeti(state, LUA_REGISTRYINDEX, metatable);
+      lua_setmetatable(state, -2);
+      sum += static_cast<bench_value*>(lua_touserdata(state, -1))->y;
+      lua_settop(state, -2);
+    }
+    return sum;
+  };
+
+  luaL_unref(state, LUA_REGISTRYINDEX, metatable);
+
+  const auto values = std::vector<int>(16, 3);
+
+  BENCHMARK("maan container") {
+    size_t size = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      vm.push(values);
+      size += vm.get<std::vector<int>>(-1).size();
+      vm.pop();
+    }
+    return size;
+  };
+
+  BENCHMARK("c api container") {
+    size_t size = 0;
+    for (auto i = 0; i < operation_count; ++i) {
+      lua_createtable(state, static_cast<int>(values.size()), 0);
+      for (size_t j = 0; j < values.size(); ++j) {
+        lua_pushinteger(state, values[j]);
+        lua_rawseti(state, -2, static_cast<int>(j + 1));
+      }
+
+      auto result = std::vector<int>{};
+      const auto length = static_cast<int>(lua_objlen(state, -1));
+      result.reserve(length);
+      for (auto j = 1; j <= length; ++j) {
+        lua_rawgeti(state, -1, j);
+        result.push_back(static_cast<int>(lua_tointeger(state, -1)));
+        lua_settop(state, -2);
+      }
+
+      size += result.size();
+      lua_settop(state, -2);
+    }
+    return size;
+  };
+}
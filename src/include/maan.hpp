@@ -1,5 +1,8 @@
 #pragma once
 
 #include <maan/vm.hpp>
+#include <maan/vm_pool.hpp>
+#include <maan/parallel.hpp>
+#include <maan/profiler.hpp>
 
 namespace maan {}
\ No newline at end of file
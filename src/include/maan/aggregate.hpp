@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+
 #include <maan/vm_types.hpp>
 #include <maan/utilities.hpp>
 
@@ -9,14 +12,74 @@
 namespace maan::aggregate {
 template <typename T>
 concept is_lua_convertable = std::is_class_v<std::remove_cvref_t<T>> && utilities::member_countable<std::remove_cvref_t<T>> &&
-                             !std::is_same_v<vm_function, std::remove_cvref_t<T>> && !std::is_same_v<vm_table, std::remove_cvref_t<T>>;
+                             !std::is_same_v<vm_function, std::remove_cvref_t<T>> && !std::is_same_v<vm_table, std::remove_cvref_t<T>> &&
+                             !vm_types::detail::is_lua_convertable_container<std::remove_cvref_t<T>> &&
+                             !vm_types::by_value<std::remove_cvref_t<T>>;
+
+// opt-in per type, the aggregate is converted to a single table keyed by field name instead of one stack slot per member
+template <typename T>
+inline constexpr bool named_fields = false;
+
+// the keys used for named_fields aggregates, specialise to replace the reflected member names
+template <typename T>
+inline constexpr auto field_names = utilities::member_names<T>();
 
 template <is_lua_convertable T>
 MAAN_INLINE static constexpr int stack_size() {
   using type = std::remove_cvref_t<T>;
-  return utilities::member_count<type>();
+
+  if constexpr (named_fields<type>) {
+    return 1;
+  } else {
+    return utilities::member_count<type>();
+  }
 }
 
+namespace detail {
+// maps a field name to its member index with a single probe, the seed is searched at compile time
+// so that every name of the type lands in its own bucket
+template <typename T>
+struct field_lookup {
+  static constexpr auto& names = field_names<T>;
+  static constexpr size_t bucket_count = std::bit_ceil(names.size() * 2);
+
+  static_assert(names.size() == static_cast<size_t>(utilities::member_count<T>()), "field_names needs a name for every member");
+
+  [[nodiscard]] MAAN_INLINE static constexpr size_t bucket(std::string_view const key, uint32_t const seed) {
+    return utilities::fnv1a32_hash(key, 0x811c9dc5 ^ seed) & (bucket_count - 1);
+  }
+
+  static constexpr uint32_t seed = []() {
+    for (uint32_t candidate = 0; candidate < 0x10000; ++candidate) {
+      std::array<bool, bucket_count> used{};
+
+      const auto collides = std::ranges::any_of(names, [&](std::string_view const name) { return std::exchange(used[bucket(name, candidate)], true); });
+      if (!collides) {
+        return candidate;
+      }
+    }
+
+    throw "field names have no perfect hash, check for duplicate names";
+  }();
+
+  static constexpr auto buckets = []() {
+    std::array<int8_t, bucket_count> result{};
+    result.fill(-1);
+
+    for (size_t i = 0; i < names.size(); ++i) {
+      result[bucket(names[i], seed)] = static_cast<int8_t>(i);
+    }
+
+    return result;
+  }();
+
+  [[nodiscard]] MAAN_INLINE static int find(std::string_view const key) {
+    const auto field = buckets[bucket(key, seed)];
+    return field >= 0 && names[field] == key ? field : -1;
+  }
+};
+} // namespace detail
+
 template <size_t index = 0, typename... types>
 MAAN_INLINE static void set_tuple(lua_State* state, int stack_index, std::tuple<types...>& tuple) {
   if constexpr (index == sizeof...(types)) {
@@ -48,41 +111,113 @@ template <is_lua_convertable T>
 MAAN_INLINE static bool is(lua_State* state, int const index) {
   using type = std::remove_cvref_t<T>;
 
-  static constexpr auto count = utilities::member_count<type>();
+  if constexpr (named_fields<type>) {
+    return operations::is(state, index, vm_type_tag::table);
+  } else {
+    static constexpr auto count = utilities::member_count<type>();
 
-  const auto stack_size = operations::size(state);
-  const auto start_index = operations::abs(state, index);
-  const auto stop_index = start_index + count - 1;
+    const auto stack_size = operations::size(state);
+    const auto start_index = operations::abs(state, index);
+    const auto stop_index = start_index + count - 1;
 
-  if (stop_index > stack_size) [[unlikely]] {
-    return false;
-  }
+    if (stop_index > stack_size) [[unlikely]] {
+      return false;
+    }
 
-  const auto fn = [state, start_index]<typename... types>() { return check<0, types...>(state, start_index); };
+    const auto fn = [state, start_index]<typename... types>() { return check<0, types...>(state, start_index); };
 
-  return utilities::visit_members_types<T>(T{}, fn);
+    return utilities::visit_members_types<T>(T{}, fn);
+  }
 }
 
 MAAN_INLINE static void push(lua_State* state, is_lua_convertable auto&& value) {
-  utilities::visit_members(std::forward<decltype(value)>(value), [state](auto&&... members) { (vm_types::push(state, members), ...); });
+  using type = std::remove_cvref_t<decltype(value)>;
+
+  if constexpr (named_fields<type>) {
+    static constexpr auto& names = field_names<type>;
+    lua_createtable(state, 0, static_cast<int>(names.size()));
+
+    utilities::visit_members(value, [state](auto const&... members) {
+      const auto fields = std::tie(members...);
+
+      [&]<size_t... i>(std::index_sequence<i...>) {
+        const auto set_field = [state]<typename member_type>(std::string_view const name, member_type const& member) {
+          lua_pushlstring(state, name.data(), name.size());
+
+          if constexpr (is_lua_convertable<member_type> && named_fields<member_type>) {
+            push(state, member);
+          } else {
+            vm_types::push(state, member);
+          }
+
+          lua_rawset(state, -3);
+        };
+
+        (set_field(names[i], std::get<i>(fields)), ...);
+      }(std::index_sequence_for<decltype(members)...>{});
+    });
+  } else {
+    utilities::visit_members(std::forward<decltype(value)>(value), [state](auto&&... members) { (vm_types::push(state, members), ...); });
+  }
 }
 
 template <is_lua_convertable T>
 MAAN_INLINE static decltype(auto) get(lua_State* state, int const index) {
   using type = std::remove_cvref_t<T>;
-  static constexpr auto count = stack_size<type>();
 
-  const auto stack_start_index = operations::abs(state, index);
+  if constexpr (named_fields<type>) {
+    const auto table_index = operations::abs(state, index);
 
-  const auto fn = [state, stack_start_index]<typename... types>() {
-    std::tuple<types...> member_values;
-    set_tuple(state, stack_start_index, member_values);
+    type result{};
+    if (!operations::is(state, table_index, vm_type_tag::table)) [[unlikely]] {
+      return result;
+    }
 
-    const auto aggregate_constructor = [](auto&&... params) -> type { return type{params...}; };
-    return std::apply(aggregate_constructor, member_values);
-  };
+    // a single traversal instead of one lookup per field, unknown keys are skipped
+    lua_pushnil(state);
+    while (lua_next(state, table_index) != 0) {
+      if (operations::is(state, -2, vm_type_tag::string)) {
+        size_t size{};
+        const auto* key = lua_tolstring(state, -2, &size);
+
+        if (const auto field = detail::field_lookup<type>::find({key, size}); field >= 0) {
+          utilities::visit_members(result, [state, field](auto&... members) {
+            auto fields = std::tie(members...);
+
+            [&]<size_t... i>(std::index_sequence<i...>) {
+              const auto get_field = [state]<typename member_type>(member_type& member) {
+                if constexpr (is_lua_convertable<member_type> && named_fields<member_type>) {
+                  member = get<member_type>(state, -1);
+                } else {
+                  member = vm_types::get<member_type>(state, -1);
+                }
+              };
+
+              (void)((field == static_cast<int>(i) && (get_field(std::get<i>(fields)), true)) || ...);
+            }(std::index_sequence_for<decltype(members)...>{});
+          });
+        }
+      }
+
+      operations::pop(state, 1);
+    }
 
-  return utilities::visit_members_types<T>(T{}, fn);
+    return result;
+  } else {
+    static constexpr auto count = stack_size<type>();
+
+    const auto stack_start_index = operations::abs(state, index);
+
+    const auto fn = [state, stack_start_index]<typename... types>() {
+      std::tuple<types...> member_values;
+      set_tuple(state, stack_start_index, member_values);
+
+      const auto aggregate_constructor = [](auto&&... params) -> type { return type{params...}; };
+      return std::apply(aggregate_constructor, member_values);
+    };
+
+    return utilities::visit_members_types<T>(T{}, fn);
+  }
 }
 
 template <is_lua_convertable T>
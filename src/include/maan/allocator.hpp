@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#include <lua.hpp>
+#include <maan/utilities.hpp>
+
+namespace maan::allocator {
+// any object with the semantics of lua_Alloc, minus the user data pointer
+template <typename T>
+concept is_allocator = requires(T& allocator, void* ptr, size_t size) {
+  { allocator(ptr, size, size) } -> std::same_as<void*>;
+};
+
+template <is_allocator T>
+inline void* function(void* user_data, void* ptr, size_t const old_size, size_t const new_size) {
+  return (*static_cast<T*>(user_data))(ptr, old_size, new_size);
+}
+
+struct statistics {
+  size_t live_bytes;
+  size_t peak_bytes;
+  size_t allocation_count;
+  size_t reallocation_count;
+  size_t free_count;
+  size_t failed_count;
+};
+
+// size class pools for the small objects lua allocates most, larger blocks go to malloc.
+// allocations that would grow live_bytes past the quota fail, which lua reports as LUA_ERRMEM.
+// a pool belongs to a single vm and has to outlive it
+class pool {
+  static constexpr size_t granularity = 16;
+  static constexpr size_t class_count = 16;
+  static constexpr size_t maximum_pooled_size = granularity * class_count;
+  static constexpr size_t block_size = 64 * 1024;
+
+  struct free_node {
+    free_node* next;
+  };
+
+  struct alignas(granularity) block_header {
+    block_header* next;
+  };
+
+  std::array<free_node*, class_count> free_lists{};
+  std::array<std::byte*, class_count> cursors{};
+  std::array<std::byte*, class_count> limits{};
+  block_header* blocks = nullptr;
+
+  size_t quota;
+  statistics stats{};
+
+  [[nodiscard]] MAAN_INLINE static constexpr size_t size_class(size_t const size) {
+    return (size - 1) / granularity;
+  }
+
+  [[nodiscard]] MAAN_INLINE static constexpr bool is_pooled(size_t const size) {
+    return size != 0 && size <= maximum_pooled_size;
+  }
+
+  MAAN_NOINLINE bool grow(size_t const index) {
+    auto* memory = static_cast<std::byte*>(::operator new(block_size, std::align_val_t{granularity}, std::nothrow));
+    if (memory == nullptr) {
+      return false;
+    }
+
+    auto* header = new (memory) block_header{blocks};
+    blocks = header;
+
+    cursors[index] = memory + sizeof(block_header);
+    limits[index] = memory + block_size;
+    return true;
+  }
+
+  [[nodiscard]] MAAN_INLINE void* allocate(size_t const size) {
+    if (!is_pooled(size)) {
+      return std::malloc(size);
+    }
+
+    const auto index = size_class(size);
+    if (auto* node = free_lists[index]; node != nullptr) {
+      free_lists[index] = node->next;
+      return node;
+    }
+
+    const auto slot_size = (index + 1) * granularity;
+    if (static_cast<size_t>(limits[index] - cursors[index]) < slot_size && !grow(index)) [[unlikely]] {
+      return nullptr;
+    }
+
+    return std::exchange(cursors[index], cursors[index] + slot_size);
+  }
+
+  MAAN_INLINE void deallocate(void* ptr, size_t const size) {
+    if (!is_pooled(size)) {
+      return std::free(ptr);
+    }
+
+    const auto index = size_class(size);
+    free_lists[index] = new (ptr) free_node{free_lists[index]};
+  }
+
+  [[nodiscard]] MAAN_INLINE void* reallocate(void* ptr, size_t const old_size, size_t const new_size) {
+    if (is_pooled(old_size) && is_pooled(new_size) && size_class(old_size) == size_class(new_size)) {
+      return ptr;
+    }
+
+    if (!is_pooled(old_size) && !is_pooled(new_size)) {
+      return std::realloc(ptr, new_size);
+    }
+
+    // the block moves between malloc and a size class or between two size classes, keeping the old block on failure would
+    // later free it into the wrong place. LuaJIT raises a memory error for a failed shrink like it does for growth
+    auto* result = allocate(new_size);
+    if (result == nullptr) [[unlikely]] {
+      return nullptr;
+    }
+
+    std::memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    deallocate(ptr, old_size);
+    return result;
+  }
+
+public:
+  static constexpr size_t unlimited = std::numeric_limits<size_t>::max();
+
+  explicit pool(size_t const quota = unlimited) : quota{quota} {}
+
+  ~pool() {
+    while (blocks != nullptr) {
+      auto* next = blocks->next;
+      ::operator delete(static_cast<void*>(blocks), std::align_val_t{granularity});
+      blocks = next;
+    }
+  }
+
+  pool(pool const&) = delete;
+  pool& operator=(pool const&) = delete;
+  pool(pool&&) = delete;
+  pool& operator=(pool&&) = delete;
+
+  void* operator()(void* ptr, size_t const old_size, size_t const new_size) noexcept {
+    // lua passes a meaningless old size for new blocks
+    const auto current_size = ptr != nullptr ? old_size : 0;
+
+    if (new_size == 0) {
+      if (ptr != nullptr) {
+        deallocate(ptr, current_size);
+        stats.live_bytes -= current_size;
+        ++stats.free_count;
+      }
+
+      return nullptr;
+    }
+
+    // only growth counts against the quota, shrinking only fails when a block has to move and no memory is left
+    if (new_size > current_size && stats.live_bytes - current_size + new_size > quota) [[unlikely]] {
+      ++stats.failed_count;
+      return nullptr;
+    }
+
+    auto* result = ptr == nullptr ? allocate(new_size) : reallocate(ptr, current_size, new_size);
+    if (result == nullptr) [[unlikely]] {
+      ++stats.failed_count;
+      return nullptr;
+    }
+
+    ++(ptr == nullptr ? stats.allocation_count : stats.reallocation_count);
+
+    stats.live_bytes = stats.live_bytes - current_size + new_size;
+    if (stats.live_bytes > stats.peak_bytes) {
+      stats.peak_bytes = stats.live_bytes;
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] statistics const& get_statistics() const {
+    return stats;
+  }
+
+  [[nodiscard]] size_t get_quota() const {
+    return quota;
+  }
+
+  void set_quota(size_t const new_quota) {
+    quota = new_quota;
+  }
+};
+
+static_assert(is_allocator<pool>, "pool has to satisfy is_allocator");
+} // namespace maan::allocator
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include <lua.hpp>
+#include <maan/utilities.hpp>
+#include <maan/operations.hpp>
+
+namespace maan {
+// keeps the lua_dump output of loaded chunks keyed by a hash of their name and source,
+// so loading the same chunk again goes through the bytecode loader instead of the parser.
+// entries that fail to load are dropped and rebuilt from the source, only point it at a directory the host controls.
+class bytecode_cache {
+  using entry = std::shared_ptr<const std::string>;
+
+  mutable std::shared_mutex mutex;
+  std::unordered_map<uint64_t, entry> entries;
+  std::filesystem::path directory;
+
+  std::atomic<size_t> hit_count{};
+  std::atomic<size_t> miss_count{};
+  std::atomic<uint64_t> build{};
+
+#if defined(LUAJIT_VERSION_NUM)
+  static constexpr uint64_t default_seed = utilities::fnv1a64_hash({}) ^ LUAJIT_VERSION_NUM;
+#else
+  static constexpr uint64_t default_seed = utilities::fnv1a64_hash({});
+#endif
+
+  [[nodiscard]] entry find(uint64_t const key) {
+    {
+      std::shared_lock lock{mutex};
+      if (const auto it = entries.find(key); it != entries.end()) {
+        return it->second;
+      }
+    }
+
+    if (directory.empty()) {
+      return nullptr;
+    }
+
+    std::ifstream file{path(key), std::ios::binary};
+    if (!file) {
+      return nullptr;
+    }
+
+    auto bytecode = std::make_shared<std::string>(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    if (bytecode->empty()) {
+      return nullptr;
+    }
+
+    std::unique_lock lock{mutex};
+    return entries.try_emplace(key, std::move(bytecode)).first->second;
+  }
+
+  void store(uint64_t const key, std::string&& bytecode) {
+    auto value = std::make_shared<const std::string>(std::move(bytecode));
+
+    if (!directory.empty()) {
+      write(key, *value);
+    }
+
+    std::unique_lock lock{mutex};
+    entries.insert_or_assign(key, std::move(value));
+  }
+
+  // writes to a temporary file only this writer uses and renames it into place, so concurrent writers and readers never
+  // observe a mixed or partial chunk. a failed write leaves no file behind
+  void write(uint64_t const key, std::string const& bytecode) const {
+    thread_local auto random = std::mt19937_64{std::random_device{}()};
+
+    auto temporary = path(key);
+    temporary += '.' + hex(random()) + ".tmp";
+
+    auto written = false;
+    if (std::ofstream file{temporary, std::ios::binary | std::ios::trunc}; file) {
+      file.write(bytecode.data(), static_cast<std::streamsize>(bytecode.size()));
+      written = file.good();
+
+      file.close();
+      written = written && file.good();
+    }
+
+    std::error_code error;
+    if (written) {
+      std::filesystem::rename(temporary, path(key), error);
+    }
+
+    if (!written || error) {
+      std::filesystem::remove(temporary, error);
+    }
+  }
+
+  void erase(uint64_t const key) {
+    {
+      std::unique_lock lock{mutex};
+      entries.erase(key);
+    }
+
+    if (!directory.empty()) {
+      std::error_code error;
+      std::filesystem::remove(path(key), error);
+    }
+  }
+
+  [[nodiscard]] static std::string hex(uint64_t const value) {
+    static constexpr auto digits = "0123456789abcdef";
+
+    std::string result(16, '0');
+    for (auto i = 0; i < 16; ++i) {
+      result[15 - i] = digits[(value >> (i * 4)) & 0xf];
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] std::filesystem::path path(uint64_t const key) const {
+    return directory / (hex(key) + ".ljbc");
+  }
+
+  // bytecode only loads in the LuaJIT build that wrote it, so the version and the header flags of a dumped empty chunk
+  // (which include FR2 on GC64 builds) are part of every key
+  [[nodiscard]] uint64_t build_seed(lua_State* state) {
+    if (const auto seed = build.load(std::memory_order_relaxed); seed != 0) [[likely]] {
+      return seed;
+    }
+
+    auto seed = default_seed;
+    if (luaL_loadbuffer(state, "", 0, "=") == LUA_OK) {
+      std::string header;
+      const auto writer = +[](lua_State*, const void* data, size_t const length, void* user_data) -> int {
+        static_cast<std::string*>(user_data)->append(static_cast<const char*>(data), length);
+        return 0;
+      };
+
+      if (lua_dump(state, writer, &header) == 0) {
+        seed = utilities::fnv1a64_hash(std::string_view{header}.substr(0, 5), seed);
+      }
+    }
+    operations::pop(state, 1);
+
+    build.store(seed, std::memory_order_relaxed);
+    return seed;
+  }
+
+public:
+  bytecode_cache() = default;
+
+  explicit bytecode_cache(std::filesystem::path cache_directory) : directory{std::move(cache_directory)} {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+  }
+
+  bytecode_cache(bytecode_cache const&) = delete;
+  bytecode_cache& operator=(bytecode_cache const&) = delete;
+
+  [[nodiscard]] static uint64_t key(const char* name, std::string_view const code, uint64_t const seed = default_seed) {
+    const auto name_hash = utilities::fnv1a64_hash(name != nullptr ? std::string_view{name} : std::string_view{}, seed);
+    return utilities::fnv1a64_hash(code, utilities::fnv1a64_hash({"", 1}, name_hash));
+  }
+
+  // same results as operations::load
+  [[nodiscard]] int load(lua_State* state, const char* name, const char* code, size_t const size) {
+    const auto cache_key = key(name, {code, size}, build_seed(state));
+
+    if (const auto bytecode = find(cache_key); bytecode != nullptr) {
+      const auto result = operations::load(state, name, bytecode->data(), bytecode->size());
+      if (result != -1) [[likely]] {
+        hit_count.fetch_add(1, std::memory_order_relaxed);
+        return result;
+      }
+
+      // corrupt or foreign bytecode is dropped and the chunk is loaded from its source instead
+      operations::pop(state, 1);
+      erase(cache_key);
+    }
+
+    miss_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (const auto result = operations::load(state, name, code, size); result != LUA_OK) {
+      return result;
+    }
+
+    std::string bytecode;
+    const auto writer = +[](lua_State*, const void* data, size_t const length, void* user_data) -> int {
+      static_cast<std::string*>(user_data)->append(static_cast<const char*>(data), length);
+      return 0;
+    };
+
+    if (lua_dump(state, writer, &bytecode) == 0 && !bytecode.empty()) {
+      store(cache_key, std::move(bytecode));
+    }
+
+    return LUA_OK;
+  }
+
+  [[nodiscard]] int load(lua_State* state, const char* name, std::string_view const code) {
+    return load(state, name, code.data(), code.size());
+  }
+
+  [[nodiscard]] size_t hits() const {
+    return hit_count.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t misses() const {
+    return miss_count.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t size() const {
+    std::shared_lock lock{mutex};
+    return entries.size();
+  }
+
+  // drops the in memory entries, chunks on disk are kept
+  void clear() {
+    std::unique_lock lock{mutex};
+    entries.clear();
+  }
+
+  void reset_counters() {
+    hit_count.store(0, std::memory_order_relaxed);
+    miss_count.store(0, std::memory_order_relaxed);
+  }
+};
+} // namespace maan
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <iterator>
+#include <string_view>
+
+#include <maan/stack.hpp>
+#include <maan/function.hpp>
+#include <maan/reference.hpp>
+
+namespace maan {
+template <typename T>
+class coroutine_range;
+
+// a lua thread running a function, both are kept alive through the registry.
+// resume returns the number of values that were yielded or returned, which stay on the thread's stack until the next resume,
+// or the same negative error codes as pcall
+class coroutine {
+public:
+  enum class status {
+    ready,
+    suspended,
+    finished,
+    failed,
+  };
+
+private:
+  lua_State* state = nullptr;
+  lua_State* thread = nullptr;
+  int thread_ref = LUA_NOREF;
+  int function_ref = LUA_NOREF;
+  status current = status::failed;
+
+  MAAN_INLINE void create_thread() {
+    thread = lua_newthread(state);
+    luaL_unref(state, LUA_REGISTRYINDEX, std::exchange(thread_ref, luaL_ref(state, LUA_REGISTRYINDEX)));
+  }
+
+  MAAN_INLINE void prepare() {
+    // threads that ran to completion can start over, suspended and failed ones can't be rewound
+    if (thread != nullptr && (current == status::finished || current == status::ready)) {
+      lua_settop(thread, 0);
+    } else {
+      create_thread();
+    }
+
+    lua_rawgeti(state, LUA_REGISTRYINDEX, function_ref);
+    lua_xmove(state, thread, 1);
+    current = status::ready;
+  }
+
+  MAAN_INLINE void release() {
+    if (state == nullptr) {
+      return;
+    }
+
+    luaL_unref(state, LUA_REGISTRYINDEX, thread_ref);
+    luaL_unref(state, LUA_REGISTRYINDEX, function_ref);
+  }
+
+public:
+  // the function at index is run by the coroutine
+  MAAN_INLINE coroutine(lua_State* state, int const index) : state{state} {
+    operations::copy(state, index);
+    function_ref = luaL_ref(state, LUA_REGISTRYINDEX);
+    prepare();
+  }
+
+  MAAN_INLINE coroutine(vm_function const& other) : coroutine(other.state, other.location) {}
+
+  MAAN_INLINE coroutine(function const& other) : coroutine(other.get_state(), other.get_location()) {}
+
+  MAAN_INLINE coroutine(function_reference const& other) : state{other.get_state()} {
+    other.push();
+    function_ref = luaL_ref(state, LUA_REGISTRYINDEX);
+    prepare();
+  }
+
+  MAAN_INLINE ~coroutine() {
+    release();
+  }
+
+  coroutine(coroutine const&) = delete;
+  coroutine& operator=(coroutine const&) = delete;
+
+  MAAN_INLINE coroutine(coroutine&& other) noexcept
+      : state{std::exchange(other.state, nullptr)}, thread{std::exchange(other.thread, nullptr)}, thread_ref{other.thread_ref},
+        function_ref{other.function_ref}, current{other.current} {}
+
+  MAAN_INLINE coroutine& operator=(coroutine&& other) noexcept {
+    if (this != &other) {
+      release();
+
+      state = std::exchange(other.state, nullptr);
+      thread = std::exchange(other.thread, nullptr);
+      thread_ref = other.thread_ref;
+      function_ref = other.function_ref;
+      current = other.current;
+    }
+
+    return *this;
+  }
+
+  // resuming a finished or failed coroutine returns -1 without running anything
+  template <typename... Ts>
+  [[nodiscard]] MAAN_INLINE int resume(Ts&&... args) {
+    static constexpr auto stack_slot_count = stack::slot_count<Ts...>();
+
+    if (current == status::suspended) {
+      // drop the values of the last yield
+      lua_settop(thread, 0);
+    } else if (current != status::ready) [[unlikely]] {
+      return -1;
+    }
+
+    if (!operations::reserve(thread, stack_slot_count)) [[unlikely]] {
+      return -5;
+    }
+
+    if constexpr (sizeof...(Ts) != 0) {
+      (stack::push(thread, std::forward<Ts>(args)), ...);
+    }
+
+    switch (lua_resume(thread, stack_slot_count)) {
+    case 0: {
+      current = status::finished;
+      return operations::size(thread);
+    }
+    case LUA_YIELD: {
+      current = status::suspended;
+      return operations::size(thread);
+    }
+    case LUA_ERRMEM: {
+      current = status::failed;
+      return -2;
+    }
+    case LUA_ERRERR: {
+      current = status::failed;
+      return -3;
+    }
+    default: {
+      current = status::failed;
+      return -1;
+    }
+    }
+  }
+
+  // starts the function over, reusing the thread if it ran to completion
+  MAAN_INLINE void reset() {
+    prepare();
+  }
+
+  // starts over with the function at index
+  MAAN_INLINE void reset(int const index) {
+    operations::copy(state, index);
+    lua_rawseti(state, LUA_REGISTRYINDEX, function_ref);
+    prepare();
+  }
+
+  [[nodiscard]] MAAN_INLINE status get_status() const {
+    return current;
+  }
+
+  [[nodiscard]] MAAN_INLINE bool resumable() const {
+    return current == status::ready || current == status::suspended;
+  }
+
+  // the values of the last resume are at 1 to result count
+  template <typename T>
+  [[nodiscard]] MAAN_INLINE decltype(auto) get(int const index) const {
+    return stack::get<T>(thread, index);
+  }
+
+  template <typename T>
+  [[nodiscard]] MAAN_INLINE bool is(int const index) const {
+    return stack::is<T>(thread, index);
+  }
+
+  [[nodiscard]] MAAN_INLINE std::string_view error() const {
+    if (current != status::failed || operations::size(thread) == 0) {
+      return {};
+    }
+
+    size_t size = 0;
+    const auto* message = lua_tolstring(thread, -1, &size);
+    return message != nullptr ? std::string_view{message, size} : std::string_view{};
+  }
+
+  [[nodiscard]] MAAN_INLINE lua_State* get_state() const {
+    return state;
+  }
+
+  [[nodiscard]] MAAN_INLINE lua_State* get_thread() const {
+    return thread;
+  }
+
+  // iterates over the values the function yields, the values it returns at the end aren't part of the range
+  template <typename T>
+  [[nodiscard]] MAAN_INLINE coroutine_range<T> range() {
+    if (current != status::ready) {
+      reset();
+    }
+
+    return coroutine_range<T>{this};
+  }
+};
+
+template <typename T>
+class coroutine_range {
+  coroutine* routine;
+
+public:
+  struct sentinel {};
+
+  class iterator {
+    coroutine* routine = nullptr;
+
+  public:
+    using value_type = std::remove_cvref_t<T>;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+
+    MAAN_INLINE explicit iterator(coroutine* routine) : routine{routine} {}
+
+    [[nodiscard]] MAAN_INLINE decltype(auto) operator*() const {
+      return routine->get<T>(1);
+    }
+
+    MAAN_INLINE iterator& operator++() {
+      (void)routine->resume();
+      return *this;
+    }
+
+    MAAN_INLINE void operator++(int) {
+      ++*this;
+    }
+
+    [[nodiscard]] MAAN_INLINE bool operator==(sentinel) const {
+      return routine->get_status() != coroutine::status::suspended;
+    }
+  };
+
+  MAAN_INLINE explicit coroutine_range(coroutine* routine) : routine{routine} {}
+
+  [[nodiscard]] MAAN_INLINE iterator begin() {
+    (void)routine->resume();
+    return iterator{routine};
+  }
+
+  [[nodiscard]] MAAN_INLINE sentinel end() const {
+    return {};
+  }
+};
+} // namespace maan
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <lua.hpp>
+#include <maan/utilities.hpp>
+#include <maan/operations.hpp>
+#include <maan/aggregate.hpp>
+
+namespace maan::ffi {
+namespace detail {
+template <typename T>
+struct c_array {
+  using type = T;
+};
+
+template <typename T, size_t size>
+struct c_array<std::array<T, size>> {
+  using type = typename c_array<T>::type[size];
+};
+
+template <typename T, size_t size>
+struct c_array<T[size]> {
+  using type = typename c_array<T>::type[size];
+};
+
+// std::array members are declared as the c arrays they wrap
+template <typename T>
+using c_array_type = typename c_array<std::remove_cv_t<T>>::type;
+
+template <typename T>
+concept is_scalar = std::is_arithmetic_v<T> && !std::is_same_v<T, long double>;
+
+template <typename T>
+concept is_struct = std::is_class_v<T> && std::is_standard_layout_v<T> && utilities::member_countable<T> && !vm_types::detail::is_array<T>;
+
+template <typename T>
+consteval std::string_view scalar_name() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return "bool";
+  } else if constexpr (std::is_same_v<T, char>) {
+    return "char";
+  } else if constexpr (std::is_same_v<T, float>) {
+    return "float";
+  } else if constexpr (std::is_same_v<T, double>) {
+    return "double";
+  } else if constexpr (std::is_signed_v<T>) {
+    constexpr std::array<std::string_view, 8> names = {"int8_t", "int16_t", "", "int32_t", "", "", "", "int64_t"};
+    return names[sizeof(T) - 1];
+  } else {
+    constexpr std::array<std::string_view, 8> names = {"uint8_t", "uint16_t", "", "uint32_t", "", "", "", "uint64_t"};
+    return names[sizeof(T) - 1];
+  }
+}
+
+// structs are named after their type hash, the c++ name isn't a valid c identifier for nested or templated types
+template <typename T>
+inline constexpr auto struct_name = []() {
+  constexpr auto hash = utilities::type_tag<std::remove_cv_t<T>>::hash();
+
+  std::array<char, 14> name = {'m', 'a', 'a', 'n', '_'};
+  for (size_t i = 0; i < 8; ++i) {
+    name[5 + i] = "0123456789abcdef"[(hash >> (28 - 4 * i)) & 0xf];
+  }
+  return name;
+}();
+
+template <typename T>
+MAAN_INLINE constexpr std::string_view name_of() {
+  return {struct_name<T>.data(), struct_name<T>.size() - 1};
+}
+
+template <typename T>
+void append_member(std::string& declaration, std::string_view const name) {
+  using type = c_array_type<T>;
+  using element_type = std::remove_all_extents_t<type>;
+
+  if constexpr (is_scalar<element_type>) {
+    declaration += scalar_name<element_type>();
+  } else if constexpr (is_struct<element_type>) {
+    declaration += name_of<element_type>();
+  } else {
+    static_assert(std::is_same_v<void, element_type>, "ffi structs can only have arithmetic, struct or array members");
+  }
+
+  declaration += ' ';
+  declaration += name;
+
+  [&]<size_t... i>(std::index_sequence<i...>) {
+    ((declaration += '[', declaration += std::to_string(std::extent_v<type, i>), declaration += ']'), ...);
+  }(std::make_index_sequence<std::rank_v<type>>{});
+
+  declaration += "; ";
+}
+} // namespace detail
+
+// the ffi.cdef declaration of T, nested structs are referenced by name and have to be declared before it
+template <typename T>
+[[nodiscard]] std::string declaration() {
+  static_assert(detail::is_struct<T>, "ffi types have to be standard layout aggregates");
+  static constexpr auto& names = aggregate::field_names<T>;
+
+  auto result = std::string{"typedef struct { "};
+  utilities::visit_members_types<T>(T{}, [&result]<typename... members>() {
+    size_t index = 0;
+    (detail::append_member<std::remove_cvref_t<members>>(result, names[index++]), ...);
+  });
+  result += "} ";
+  result += detail::name_of<T>();
+  result += ';';
+  return result;
+}
+
+// the name T is declared under, scripts can use it with ffi.typeof or ffi.new
+template <typename T>
+[[nodiscard]] constexpr std::string_view name() {
+  return detail::name_of<std::remove_cv_t<T>>();
+}
+
+namespace detail {
+// every vm caches the pointer ctype of a type in its registry under the address of this key
+template <typename T>
+inline char ctype_key{};
+
+// the ffi module, opened if the vm didn't open it already
+MAAN_INLINE inline void push_module(lua_State* state) {
+  lua_getfield(state, LUA_REGISTRYINDEX, "_LOADED");
+  lua_getfield(state, -1, LUA_FFILIBNAME);
+  operations::remove(state, -2);
+
+  if (operations::is(state, -1, vm_type_tag::table)) [[likely]] {
+    return;
+  }
+
+  operations::pop(state, 1);
+  lua_pushcclosure(state, luaopen_ffi, 0);
+  lua_call(state, 0, 1);
+}
+
+// calls ffi.<function>(argument) with the results on top of the stack, errors are popped
+MAAN_INLINE inline bool call(lua_State* state, const char* function, std::string_view const argument, int const result_count) {
+  push_module(state);
+  lua_getfield(state, -1, function);
+  operations::remove(state, -2);
+  lua_pushlstring(state, argument.data(), argument.size());
+
+  if (lua_pcall(state, 1, result_count, 0) != 0) [[unlikely]] {
+    operations::pop(state, 1);
+    return false;
+  }
+
+  return true;
+}
+
+template <typename T>
+bool push_ctype(lua_State* state);
+
+template <typename T>
+bool define(lua_State* state) {
+  // nested structs are declared first, once per vm like every other struct
+  const auto nested = utilities::visit_members_types<T>(T{}, [state]<typename... members>() {
+    const auto declare_member = [state]<typename member>() {
+      using element_type = std::remove_all_extents_t<c_array_type<std::remove_cvref_t<member>>>;
+
+      if constexpr (is_struct<element_type>) {
+        if (!push_ctype<element_type>(state)) {
+          return false;
+        }
+
+        operations::pop(state, 1);
+      }
+
+      return true;
+    };
+
+    return (true && ... && declare_member.template operator()<members>());
+  });
+
+  if (!nested) [[unlikely]] {
+    return false;
+  }
+
+  if (!call(state, "cdef", ffi::declaration<T>(), 0)) [[unlikely]] {
+    return false;
+  }
+
+  // a layout that differs from the compiler's would make every access through the pointer wrong
+  if (!call(state, "sizeof", name_of<T>(), 1)) [[unlikely]] {
+    return false;
+  }
+
+  const auto size = lua_tointeger(state, -1);
+  operations::pop(state, 1);
+  return size == static_cast<lua_Integer>(sizeof(T));
+}
+
+// pushes the pointer ctype of T, declaring the struct the first time a vm needs it
+template <typename T>
+bool push_ctype(lua_State* state) {
+  lua_pushlightuserdata(state, &ctype_key<T>);
+  lua_rawget(state, LUA_REGISTRYINDEX);
+
+  if (!operations::is(state, -1, vm_type_tag::nil)) [[likely]] {
+    return true;
+  }
+
+  operations::pop(state, 1);
+
+  using type = std::remove_const_t<T>;
+  static_assert(is_struct<type>, "ffi types have to be standard layout aggregates");
+
+  if constexpr (std::is_const_v<T>) {
+    if (!push_ctype<type>(state)) [[unlikely]] {
+      return false;
+    }
+
+    operations::pop(state, 1);
+  } else if (!define<type>(state)) [[unlikely]] {
+    return false;
+  }
+
+  auto pointer = std::string{std::is_const_v<T> ? "const " : ""};
+  pointer += name_of<type>();
+  pointer += " *";
+
+  if (!call(state, "typeof", pointer, 1)) [[unlikely]] {
+    return false;
+  }
+
+  lua_pushlightuserdata(state, &ctype_key<T>);
+  lua_pushvalue(state, -2);
+  lua_rawset(state, LUA_REGISTRYINDEX);
+  return true;
+}
+
+// the values a c function can take or return without any conversion on the c++ side
+template <typename T>
+concept is_c_pointer = std::is_pointer_v<T> && (std::is_void_v<std::remove_cv_t<std::remove_pointer_t<T>>> ||
+                                                std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char> ||
+                                                is_struct<std::remove_cv_t<std::remove_pointer_t<T>>>);
+
+template <typename T>
+concept is_c_compatible = std::is_void_v<T> || is_scalar<T> || is_c_pointer<T>;
+
+template <typename T>
+std::string c_name() {
+  if constexpr (std::is_void_v<T>) {
+    return "void";
+  } else if constexpr (is_scalar<T>) {
+    return std::string{scalar_name<T>()};
+  } else {
+    using pointee = std::remove_pointer_t<T>;
+    using type = std::remove_cv_t<pointee>;
+
+    auto result = std::string{std::is_const_v<pointee> ? "const " : ""};
+    if constexpr (std::is_void_v<type>) {
+      result += "void";
+    } else if constexpr (std::is_same_v<type, char>) {
+      result += "char";
+    } else {
+      result += name_of<type>();
+    }
+    result += " *";
+    return result;
+  }
+}
+
+template <typename T>
+bool declare_pointee(lua_State* state) {
+  using type = std::remove_cv_t<std::remove_pointer_t<T>>;
+
+  if constexpr (std::is_pointer_v<T> && is_struct<type>) {
+    if (!push_ctype<type>(state)) [[unlikely]] {
+      return false;
+    }
+
+    operations::pop(state, 1);
+  }
+
+  return true;
+}
+
+// pushes the function pointer ctype of a signature, cached like the struct pointer ctypes
+template <typename R, typename... Ts>
+bool push_function_ctype(lua_State* state) {
+  lua_pushlightuserdata(state, &ctype_key<R (*)(Ts...)>);
+  lua_rawget(state, LUA_REGISTRYINDEX);
+
+  if (!operations::is(state, -1, vm_type_tag::nil)) [[likely]] {
+    return true;
+  }
+
+  operations::pop(state, 1);
+
+  if (!(declare_pointee<R>(state) && (declare_pointee<Ts>(state) && ...))) [[unlikely]] {
+    return false;
+  }
+
+  auto signature = c_name<R>();
+  signature += " (*)(";
+  if constexpr (sizeof...(Ts) == 0) {
+    signature += "void";
+  } else {
+    size_t index = 0;
+    ((signature += index++ == 0 ? "" : ", ", signature += c_name<Ts>()), ...);
+  }
+  signature += ')';
+
+  if (!call(state, "typeof", signature, 1)) [[unlikely]] {
+    return false;
+  }
+
+  lua_pushlightuserdata(state, &ctype_key<R (*)(Ts...)>);
+  lua_pushvalue(state, -2);
+  lua_rawset(state, LUA_REGISTRYINDEX);
+  return true;
+}
+} // namespace detail
+
+// declares T and every struct it contains in the vm, fails if a script already declared the name or the layouts differ
+template <typename T>
+bool declare(lua_State* state) {
+  if (!detail::push_ctype<T>(state)) [[unlikely]] {
+    return false;
+  }
+
+  operations::pop(state, 1);
+  return true;
+}
+
+// pushes a pointer cdata that refers to the object without copying it, or nil if T can't be declared.
+// the object has to outlive every use the script makes of the pointer
+template <typename T>
+bool push(lua_State* state, T* pointer) {
+  if (!detail::push_ctype<T>(state)) [[unlikely]] {
+    lua_pushnil(state);
+    return false;
+  }
+
+  // void* initialises any pointer type, which light userdata converts to
+  lua_pushlightuserdata(state, const_cast<std::remove_const_t<T>*>(pointer));
+  lua_call(state, 1, 1);
+  return true;
+}
+
+// arrays are pushed as a pointer to their first element, scripts index it from 0 and have to know the size
+template <typename T, size_t extent>
+bool push(lua_State* state, std::span<T, extent> const values) {
+  return push(state, values.data());
+}
+
+// pushes fn as an ffi function pointer, or nil if its signature can't be declared. compiled traces call it directly,
+// calls through native_function::push always leave the jit because they go through a lua_CFunction.
+// only plain c signatures work: arithmetic values and pointers to void, char or ffi structs. scripts have to pass
+// exactly the declared arguments, and fn can't throw or raise lua errors since no wrapper is there to catch them
+template <typename R, typename... Ts>
+bool push_function(lua_State* state, R (*fn)(Ts...)) {
+  static_assert(detail::is_c_compatible<R> && (detail::is_c_compatible<Ts> && ...), "ffi functions need a c compatible signature");
+
+  detail::push_module(state);
+  lua_getfield(state, -1, "cast");
+  operations::remove(state, -2);
+
+  if (!detail::push_function_ctype<R, Ts...>(state)) [[unlikely]] {
+    operations::pop(state, 1);
+    lua_pushnil(state);
+    return false;
+  }
+
+  lua_pushlightuserdata(state, reinterpret_cast<void*>(fn));
+  lua_call(state, 2, 1);
+  return true;
+}
+
+// whether index holds a pointer cdata to T, which is what push creates
+template <typename T>
+bool is(lua_State* state, int const index) {
+  if (!operations::is(state, index, vm_type_tag::cdata)) {
+    return false;
+  }
+
+  const auto value_index = operations::abs(state, index);
+
+  detail::push_module(state);
+  lua_getfield(state, -1, "istype");
+  operations::remove(state, -2);
+
+  if (!detail::push_ctype<T>(state)) [[unlikely]] {
+    operations::pop(state, 1);
+    return false;
+  }
+
+  lua_pushvalue(state, value_index);
+  lua_call(state, 2, 1);
+
+  const auto result = lua_toboolean(state, -1) != 0;
+  operations::pop(state, 1);
+  return result;
+}
+
+// the pointer held by a pointer cdata, unchecked
+template <typename T>
+[[nodiscard]] MAAN_INLINE T* get(lua_State* state, int const index) {
+  return vm_types::get<cdata<T>>(state, index).get();
+}
+} // namespace maan::ffi
@@ -1,9 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+
 #include <maan/vm_function.hpp>
 #include <maan/stack.hpp>
 
 namespace maan {
+// an input of function::call_batch, parallel_map or parallel_for that failed, code is one of the negative codes call returns
+struct call_error {
+  size_t index;
+  int code;
+  std::string message;
+};
+
 class function {
   vm_function view;
   bool has_ownership;
@@ -45,12 +57,81 @@ public:
 
   template <int result_count = LUA_MULTRET, typename... types>
   [[nodiscard]] MAAN_INLINE int call(types&&... args) const {
+    // pushing the error handler before the function avoids moving it below the function afterwards
+    const auto error_function_pos = operations::push_error_handler(view.state);
     operations::copy(view.state, view.location);
-    return stack::call<result_count>(view.state, std::forward<types>(args)...);
+    return stack::invoke<result_count>(view.state, error_function_pos, std::forward<types>(args)...);
+  }
+
+  // calls the function once per input and writes each result to the output at the same index, up to the shorter of both spans.
+  // the error handler and stack space are set up once for the whole batch, failed inputs keep their output untouched and are
+  // listed in the result. memory errors and errors in the error handler clear the stack like call does and end the batch
+  template <typename In, size_t in_extent, typename Out, size_t out_extent>
+  [[nodiscard]] std::vector<call_error> call_batch(std::span<In, in_extent> const inputs, std::span<Out, out_extent> const outputs) const {
+    static_assert(!std::is_const_v<Out>, "call_batch writes its results to the output span");
+
+    static constexpr auto argument_count = stack::slot_count<In>();
+    static constexpr auto result_count = stack::slot_count<Out>();
+
+    auto* state = view.state;
+    auto errors = std::vector<call_error>{};
+    const auto count = std::min(inputs.size(), outputs.size());
+
+    const auto error_function_pos = operations::push_error_handler(state);
+    const auto base = operations::size(state);
+
+    if (!operations::reserve(state, 1 + std::max(argument_count, result_count))) [[unlikely]] {
+      if (error_function_pos != 0) {
+        operations::pop(state, 1);
+      }
+
+      errors.push_back({0, -5, {}});
+      return errors;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      lua_pushvalue(state, view.location);
+      stack::push(state, inputs[i]);
+
+      switch (lua_pcall(state, argument_count, result_count, error_function_pos)) {
+      case 0: {
+        outputs[i] = stack::get<Out>(state, -result_count);
+        break;
+      }
+      case LUA_ERRRUN: {
+        size_t size = 0;
+        const auto* message = lua_tolstring(state, -1, &size);
+        errors.push_back({i, -1, message != nullptr ? std::string{message, size} : std::string{}});
+        break;
+      }
+      case LUA_ERRMEM: {
+        operations::clear(state);
+        errors.push_back({i, -2, {}});
+        return errors;
+      }
+      default: {
+        operations::clear(state);
+        errors.push_back({i, -3, {}});
+        return errors;
+      }
+      }
+
+      lua_settop(state, base);
+    }
+
+    if (error_function_pos != 0) {
+      operations::pop(state, 1);
+    }
+
+    return errors;
   }
 
   [[nodiscard]] MAAN_INLINE int get_location() const {
     return view.location;
   }
+
+  [[nodiscard]] MAAN_INLINE lua_State* get_state() const {
+    return view.state;
+  }
 };
 } // namespace maan
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+
+#include <lua.hpp>
+#include <maan/utilities.hpp>
+#include <maan/operations.hpp>
+
+namespace maan::keys {
+namespace detail {
+inline constexpr char cache_key = 0;
+
+// every distinct key gets a dense process wide id, the same id indexes the array part of every vm's cache
+MAAN_INLINE inline int next_id() {
+  static std::atomic<int> counter{0};
+  return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+template <utilities::fixed_string name>
+MAAN_INLINE int id() {
+  static const int value = next_id();
+  return value;
+}
+
+// pushes the per-vm table holding the interned strings by id
+MAAN_INLINE inline void push_cache(lua_State* state) {
+  lua_pushlightuserdata(state, const_cast<char*>(&cache_key));
+  lua_rawget(state, LUA_REGISTRYINDEX);
+
+  if (operations::is(state, -1, vm_type_tag::table)) [[likely]] {
+    return;
+  }
+
+  operations::pop(state, 1);
+  lua_createtable(state, 32, 0);
+  lua_pushlightuserdata(state, const_cast<char*>(&cache_key));
+  lua_pushvalue(state, -2);
+  lua_rawset(state, LUA_REGISTRYINDEX);
+}
+
+// every name has its own registry key, looking it up hashes a pointer instead of the string
+template <utilities::fixed_string name>
+inline char registry_key{};
+
+// pushes the interned string from the registry, only the first push per vm creates it
+template <utilities::fixed_string name>
+MAAN_INLINE void push(lua_State* state) {
+  lua_pushlightuserdata(state, &registry_key<name>);
+  lua_rawget(state, LUA_REGISTRYINDEX);
+  if (!operations::is(state, -1, vm_type_tag::nil)) [[likely]] {
+    return;
+  }
+
+  operations::pop(state, 1);
+  lua_pushlstring(state, name.data(), name.size());
+  lua_pushlightuserdata(state, &registry_key<name>);
+  lua_pushvalue(state, -2);
+  lua_rawset(state, LUA_REGISTRYINDEX);
+}
+
+// pushes the interned string from the cache table at cache_index, only the first push per vm creates it
+template <utilities::fixed_string name>
+MAAN_INLINE void push(lua_State* state, int const cache_index) {
+  const auto key_id = id<name>();
+
+  lua_rawgeti(state, cache_index, key_id);
+  if (!operations::is(state, -1, vm_type_tag::nil)) [[likely]] {
+    return;
+  }
+
+  operations::pop(state, 1);
+  lua_pushlstring(state, name.data(), name.size());
+  lua_pushvalue(state, -1);
+  lua_rawseti(state, cache_index, key_id);
+}
+} // namespace detail
+
+// keys are pushed by stack::push through their push member, which lets table::set and table::map use them directly
+template <typename T>
+concept is_key = requires(T const& key, lua_State* state) {
+  typename T::interned_key_tag;
+  key.push(state);
+};
+} // namespace maan::keys
+
+namespace maan {
+// a string known at compile time that is created once per vm and then pushed without hashing or interning it again
+template <utilities::fixed_string name>
+struct interned {
+  using interned_key_tag = void;
+
+  static constexpr std::string_view value = name;
+
+  MAAN_INLINE static void push(lua_State* state) {
+    keys::detail::push<name>(state);
+  }
+};
+
+// an interned key read through a key_cache
+template <utilities::fixed_string name>
+struct cached_key {
+  using interned_key_tag = void;
+
+  int cache_index;
+
+  MAAN_INLINE void push(lua_State* state) const {
+    keys::detail::push<name>(state, cache_index);
+  }
+};
+
+// keeps the cache table on the stack so a batch of keys only costs an array lookup each
+class key_cache {
+  lua_State* state;
+  int location;
+
+public:
+  MAAN_INLINE explicit key_cache(lua_State* state) : state{state} {
+    keys::detail::push_cache(state);
+    location = operations::size(state);
+  }
+
+  MAAN_INLINE ~key_cache() {
+    if (location > 0) {
+      operations::remove(state, location);
+    }
+  }
+
+  key_cache(key_cache const&) = delete;
+  key_cache& operator=(key_cache const&) = delete;
+
+  MAAN_INLINE key_cache(key_cache&& other) noexcept : state{other.state}, location{std::exchange(other.location, 0)} {}
+
+  key_cache& operator=(key_cache&&) = delete;
+
+  template <utilities::fixed_string name>
+  [[nodiscard]] MAAN_INLINE cached_key<name> key() const {
+    return {location};
+  }
+
+  template <utilities::fixed_string name>
+  MAAN_INLINE void push() const {
+    keys::detail::push<name>(state, location);
+  }
+
+  [[nodiscard]] MAAN_INLINE int get_location() const {
+    return location;
+  }
+};
+} // namespace maan
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include <lua.hpp>
+#include <maan/utilities.hpp>
+#include <maan/operations.hpp>
+
+namespace maan {
+enum class library : uint32_t {
+  none = 0,
+  base = 1 << 0,
+  package = 1 << 1,
+  table = 1 << 2,
+  io = 1 << 3,
+  os = 1 << 4,
+  string = 1 << 5,
+  math = 1 << 6,
+  debug = 1 << 7,
+  bit = 1 << 8,
+  jit = 1 << 9,
+  ffi = 1 << 10,
+  all = (1 << 11) - 1,
+};
+
+MAAN_INLINE constexpr library operator|(library const lhs, library const rhs) {
+  return static_cast<library>(utilities::to_underlying(lhs) | utilities::to_underlying(rhs));
+}
+
+MAAN_INLINE constexpr library operator&(library const lhs, library const rhs) {
+  return static_cast<library>(utilities::to_underlying(lhs) & utilities::to_underlying(rhs));
+}
+
+MAAN_INLINE constexpr library operator~(library const value) {
+  return static_cast<library>(~utilities::to_underlying(value)) & library::all;
+}
+
+MAAN_INLINE constexpr bool contains(library const set, library const value) {
+  return (set & value) != library::none;
+}
+
+// eager libraries are opened when the vm is created, lazy ones the first time one of their globals is read
+template <library eager, library lazy = library::none>
+struct library_set {
+  static_assert((eager & lazy) == library::none, "a library cannot be opened eagerly and lazily");
+  static_assert(!contains(lazy, library::base), "the base library cannot be opened lazily");
+
+  static constexpr auto eager_libraries = eager;
+  static constexpr auto lazy_libraries = lazy;
+};
+} // namespace maan
+
+namespace maan::libraries {
+namespace detail {
+struct entry {
+  library flag;
+  const char* name;
+  lua_CFunction open;
+  std::array<const char*, 3> globals;
+};
+
+inline constexpr std::array<entry, 11> entries = {{
+  {library::base, "", luaopen_base, {}},
+  {library::package, LUA_LOADLIBNAME, luaopen_package, {LUA_LOADLIBNAME, "require", "module"}},
+  {library::table, LUA_TABLIBNAME, luaopen_table, {LUA_TABLIBNAME}},
+  {library::io, LUA_IOLIBNAME, luaopen_io, {LUA_IOLIBNAME}},
+  {library::os, LUA_OSLIBNAME, luaopen_os, {LUA_OSLIBNAME}},
+  {library::string, LUA_STRLIBNAME, luaopen_string, {LUA_STRLIBNAME}},
+  {library::math, LUA_MATHLIBNAME, luaopen_math, {LUA_MATHLIBNAME}},
+  {library::debug, LUA_DBLIBNAME, luaopen_debug, {LUA_DBLIBNAME}},
+  {library::bit, LUA_BITLIBNAME, luaopen_bit, {LUA_BITLIBNAME}},
+  {library::jit, LUA_JITLIBNAME, luaopen_jit, {LUA_JITLIBNAME}},
+  {library::ffi, LUA_FFILIBNAME, luaopen_ffi, {LUA_FFILIBNAME}},
+}};
+
+MAAN_INLINE inline void open(lua_State* state, entry const& item) {
+  lua_pushcclosure(state, item.open, 0);
+  lua_pushstring(state, item.name);
+  lua_call(state, 1, 0);
+}
+
+// like luaL_openlibs, ffi is only made available through require
+MAAN_INLINE inline void preload(lua_State* state, entry const& item) {
+  luaL_findtable(state, LUA_REGISTRYINDEX, "_PRELOAD", 1);
+  lua_pushcclosure(state, item.open, 0);
+  lua_setfield(state, -2, item.name);
+  operations::pop(state, 1);
+}
+
+inline int lazy_index(lua_State* state) {
+  // expected stack layout:
+  // - key
+  // - globals
+
+  if (!operations::is(state, 2, vm_type_tag::string)) {
+    lua_pushnil(state);
+    return 1;
+  }
+
+  const auto* key = lua_tolstring(state, 2, nullptr);
+  auto pending = static_cast<library>(lua_tointeger(state, lua_upvalueindex(1)));
+
+  for (const auto& item : entries) {
+    if (!contains(pending, item.flag)) {
+      continue;
+    }
+
+    const auto matches = std::ranges::any_of(item.globals, [key](const char* name) { return name != nullptr && std::strcmp(name, key) == 0; });
+    if (!matches) {
+      continue;
+    }
+
+    pending = pending & ~item.flag;
+    lua_pushinteger(state, static_cast<lua_Integer>(utilities::to_underlying(pending)));
+    lua_replace(state, lua_upvalueindex(1));
+
+    if (item.flag == library::ffi) {
+      lua_pushcclosure(state, item.open, 0);
+      lua_call(state, 0, 1);
+      lua_setfield(state, 1, item.name);
+    } else {
+      open(state, item);
+    }
+
+    // the hook isn't needed anymore once everything is open
+    if (pending == library::none) {
+      lua_pushnil(state);
+      lua_setmetatable(state, 1);
+    }
+
+    lua_rawget(state, 1);
+    return 1;
+  }
+
+  lua_pushnil(state);
+  return 1;
+}
+
+// the string metatable until the string library is opened, which replaces it with its own
+inline int lazy_string_index(lua_State* state) {
+  // expected stack layout:
+  // - key
+  // - string
+
+  // reading the global goes through lazy_index and opens the library
+  lua_getfield(state, LUA_GLOBALSINDEX, LUA_STRLIBNAME);
+  if (!operations::is(state, -1, vm_type_tag::table)) {
+    lua_pushnil(state);
+    return 1;
+  }
+
+  lua_pushvalue(state, 2);
+  lua_rawget(state, -2);
+  return 1;
+}
+
+// the jit library switches the compiler on when it is opened, vms that don't expose the global still get the compiler
+MAAN_INLINE inline void start_jit(lua_State* state) {
+  open(state, *std::ranges::find(entries, library::jit, &entry::flag));
+
+  lua_pushnil(state);
+  lua_setfield(state, LUA_GLOBALSINDEX, LUA_JITLIBNAME);
+}
+} // namespace detail
+
+inline void open(lua_State* state, library const libraries) {
+  for (const auto& item : detail::entries) {
+    if (!contains(libraries, item.flag)) {
+      continue;
+    }
+
+    if (item.flag == library::ffi) {
+      detail::preload(state, item);
+    } else {
+      detail::open(state, item);
+    }
+  }
+}
+
+// installs an __index hook on the globals table that opens a library the first time one of its globals is read
+inline void open_lazily(lua_State* state, library const libraries) {
+  if (libraries == library::none) {
+    return;
+  }
+
+  lua_createtable(state, 0, 1);
+  lua_pushinteger(state, static_cast<lua_Integer>(utilities::to_underlying(libraries)));
+  lua_pushcclosure(state, detail::lazy_index, 1);
+  lua_setfield(state, -2, "__index");
+  lua_setmetatable(state, LUA_GLOBALSINDEX);
+
+  // string methods are looked up through the string metatable and never read the global
+  if (contains(libraries, library::string)) {
+    lua_pushlstring(state, "", 0);
+    lua_createtable(state, 0, 1);
+    lua_pushcclosure(state, detail::lazy_string_index, 0);
+    lua_setfield(state, -2, "__index");
+    lua_setmetatable(state, -2);
+    operations::pop(state, 1);
+  }
+}
+
+template <library eager, library lazy>
+MAAN_INLINE void open(lua_State* state, library_set<eager, lazy>) {
+  if constexpr (!contains(eager, library::jit)) {
+    detail::start_jit(state);
+  }
+
+  open(state, eager);
+  open_lazily(state, lazy);
+}
+} // namespace maan::libraries
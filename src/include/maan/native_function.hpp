@@ -4,6 +4,19 @@
 #include <maan/vm_types.hpp>
 
 namespace maan::native_function {
+// how wrapped functions validate what scripts pass them.
+// checked compares the stack size and the type of every argument, debug only does so when MAAN_DEBUG is set,
+// unchecked converts whatever is on the stack and is meant for trusted callers that always pass the right arguments
+enum class argument_check {
+  checked,
+  debug,
+  unchecked,
+};
+
+MAAN_INLINE constexpr bool is_checked(argument_check const check) {
+  return check == argument_check::checked || (check == argument_check::debug && MAAN_DEBUG);
+}
+
 struct function_requirements {
   size_t argument_count;
   size_t stack_slot_count;
@@ -47,21 +60,31 @@ struct info<ReturnType(Ts...)> {
 
   static constexpr auto requirements = check();
 
-  template <size_t tuple_index = 0, size_t lua_index = 0>
+  template <bool checked = true, size_t tuple_index = 0, size_t lua_index = 0>
   MAAN_INLINE static void set_tuple(lua_State* state, tuple_type& tuple) {
     if constexpr (tuple_index == sizeof...(Ts)) {
+    } else if constexpr (!checked) {
+      using arg_type = std::remove_cvref_t<argument_types<tuple_index>>;
+
+      if constexpr (aggregate::is_lua_convertable<arg_type>) {
+        std::get<tuple_index>(tuple) = aggregate::get<arg_type>(state, lua_index + 1);
+        return set_tuple<checked, tuple_index + 1, lua_index + aggregate::stack_size<arg_type>()>(state, tuple);
+      } else {
+        std::get<tuple_index>(tuple) = vm_types::get<arg_type>(state, lua_index + 1);
+        return set_tuple<checked, tuple_index + 1, lua_index + 1>(state, tuple);
+      }
     } else {
       using arg_type = std::remove_cvref_t<argument_types<tuple_index>>;
 
       if constexpr (aggregate::is_lua_convertable<arg_type>) {
         if (aggregate::is<arg_type>(state, lua_index + 1)) [[likely]] {
           std::get<tuple_index>(tuple) = aggregate::get<arg_type>(state, lua_index + 1);
-          return set_tuple<tuple_index + 1, lua_index + aggregate::stack_size<arg_type>()>(state, tuple);
+          return set_tuple<checked, tuple_index + 1, lua_index + aggregate::stack_size<arg_type>()>(state, tuple);
         }
       } else {
         if (vm_types::is<arg_type>(state, lua_index + 1)) [[likely]] {
           std::get<tuple_index>(tuple) = vm_types::get<arg_type>(state, lua_index + 1);
-          return set_tuple<tuple_index + 1, lua_index + 1>(state, tuple);
+          return set_tuple<checked, tuple_index + 1, lua_index + 1>(state, tuple);
         }
       }
 
@@ -92,14 +115,47 @@ struct info<return_type (clazz::*)(types...)> : info<return_type(clazz*, types..
 template <typename clazz, typename return_type, typename... types>
 struct info<return_type (clazz::*)(types...) const> : info<return_type(clazz*, types...)> {};
 
+// lambdas and functors are described by their call operator, without the object argument
+template <typename T>
+struct call_operator;
+
+template <typename clazz, typename return_type, typename... types>
+struct call_operator<return_type (clazz::*)(types...)> {
+  using type = return_type(types...);
+};
+
+template <typename clazz, typename return_type, typename... types>
+struct call_operator<return_type (clazz::*)(types...) const> {
+  using type = return_type(types...);
+};
+
+template <typename clazz, typename return_type, typename... types>
+struct call_operator<return_type (clazz::*)(types...) noexcept> {
+  using type = return_type(types...);
+};
+
+template <typename clazz, typename return_type, typename... types>
+struct call_operator<return_type (clazz::*)(types...) const noexcept> {
+  using type = return_type(types...);
+};
+
+template <typename T>
+concept is_callable = std::is_class_v<std::remove_cvref_t<T>> && requires { &std::remove_cvref_t<T>::operator(); };
+
+template <typename T>
+  requires is_callable<T>
+struct info<T> : info<typename call_operator<decltype(&T::operator())>::type> {};
+
 template <typename T>
 concept is_cfunction = requires(T fn) {
   { fn(std::declval<lua_State*>()) } -> std::same_as<int>;
   requires std::is_function_v<std::remove_pointer_t<std::remove_cvref_t<T>>>;
 };
 
+// member functions take the object pointer as their first argument, callables with a single call operator are stored by value
 template <typename T>
-concept is_function = !is_cfunction<T> && std::is_function_v<std::remove_pointer_t<std::remove_cvref_t<T>>>;
+concept is_function = !is_cfunction<T> && (std::is_function_v<std::remove_pointer_t<std::remove_cvref_t<T>>> ||
+                                           std::is_member_function_pointer_v<std::remove_cvref_t<T>> || is_callable<T>);
 
 static_assert(is_cfunction<decltype(+[](lua_State*) -> int { return 0; })>, "yes");
 static_assert(!is_cfunction<decltype([a = 1](lua_State*) -> int { return 0; })>, "no");
@@ -112,13 +168,220 @@ MAAN_INLINE inline void push(lua_State* state, int (*fn)(lua_State*), int const
   lua_pushcclosure(state, fn, count);
 }
 
+namespace detail {
+// converts the arguments, calls the function and pushes its results, returns the number of results
+template <bool checked = true, typename function_type>
+MAAN_INLINE int invoke(lua_State* state, function_type&& function) {
+  using info = info<std::remove_cvref_t<function_type>>;
+  using ret_type = info::ret_type;
+
+  typename info::tuple_type params;
+  info::template set_tuple<checked>(state, params);
+
+  if constexpr (std::is_same_v<ret_type, void>) {
+    std::apply(std::forward<function_type>(function), std::move(params));
+    return 0;
+  } else {
+    if constexpr (aggregate::is_lua_convertable<ret_type>) {
+      // c functions are only guaranteed LUA_MINSTACK free slots
+      if constexpr (aggregate::stack_size<ret_type>() > LUA_MINSTACK) {
+        luaL_checkstack(state, aggregate::stack_size<ret_type>(), "too many results");
+      }
+
+      aggregate::push(state, std::apply(std::forward<function_type>(function), std::move(params)));
+      return aggregate::stack_size<ret_type>();
+    } else {
+      vm_types::push(state, std::apply(std::forward<function_type>(function), std::move(params)));
+      return 1;
+    }
+  }
+}
+
+template <typename function_type, bool checked = true>
+MAAN_INLINE void check_stack_size(lua_State* state) {
+  static constexpr auto requirements = info<function_type>::requirements;
+
+  if constexpr (!checked) {
+    return;
+  } else if (const auto stack_size = operations::size(state); requirements.stack_slot_count != stack_size) {
+    luaL_error(state, "invalid arguments { expected: %d | stack_size: %d }", requirements.stack_slot_count, stack_size);
+    utilities::assume_unreachable();
+  }
+}
+
+// captureless callables have nothing to store, a new one is constructed for every call
+template <typename callable_type, bool checked>
+int empty_callable_wrapper(lua_State* state) {
+  check_stack_size<callable_type, checked>(state);
+  return invoke<checked>(state, callable_type{});
+}
+
+// the callable lives inline in the userdata upvalue and is called through its concrete type
+template <typename callable_type, bool checked>
+int callable_wrapper(lua_State* state) {
+  check_stack_size<callable_type, checked>(state);
+
+  const auto* data = static_cast<vm_types::detail::lua_userdata*>(lua_touserdata(state, lua_upvalueindex(1)));
+  return invoke<checked>(state, *static_cast<callable_type*>(data->data));
+}
+
+// arguments whose checks can't tell two overloads apart, all numbers look the same to lua and so do all strings
+template <typename T>
+using check_key = std::conditional_t<
+  !std::is_same_v<T, bool> && (vm_types::detail::is_lua_convertable_integer<T> || vm_types::detail::is_lua_convertable_number<T>), double,
+  std::conditional_t<vm_types::detail::is_lua_convertable_string<T>, std::string, T>>;
+
+template <typename function_type, size_t index>
+using argument_type = std::remove_cvref_t<typename info<function_type>::template argument_types<index>>;
+
+template <typename function_type>
+inline constexpr size_t argument_count = info<function_type>::requirements.argument_count;
+
+template <typename function_type>
+inline constexpr int slot_count = static_cast<int>(info<function_type>::requirements.stack_slot_count);
+
+template <typename T>
+consteval int argument_slot_count() {
+  if constexpr (aggregate::is_lua_convertable<T>) {
+    return aggregate::stack_size<T>();
+  } else {
+    return 1;
+  }
+}
+
+// the stack offset of an argument
+template <typename function_type, size_t index>
+consteval int argument_offset() {
+  return []<size_t... i>(std::index_sequence<i...>) {
+    return (0 + ... + argument_slot_count<argument_type<function_type, i>>());
+  }(std::make_index_sequence<index>{});
+}
+
+template <typename T>
+consteval bool is_expensive_check() {
+  return aggregate::is_lua_convertable<T> || vm_types::detail::is_lua_convertable_pointer<T>;
+}
+
+template <typename function_type, size_t index, typename other_type>
+consteval bool shares_argument() {
+  using key = check_key<argument_type<function_type, index>>;
+  constexpr auto offset = argument_offset<function_type, index>();
+
+  return []<size_t... i>(std::index_sequence<i...>) {
+    return ((argument_offset<other_type, i>() == offset && std::is_same_v<check_key<argument_type<other_type, i>>, key>) || ...);
+  }(std::make_index_sequence<argument_count<other_type>>{});
+}
+
+template <typename function_type, typename other_type>
+consteval bool shares_all_arguments() {
+  return []<size_t... i>(std::index_sequence<i...>) {
+    return (shares_argument<function_type, i, other_type>() && ...);
+  }(std::make_index_sequence<argument_count<function_type>>{});
+}
+
+template <typename... function_types>
+struct overload_set {
+  using storage = std::tuple<function_types...>;
+
+  template <size_t index>
+  using function_type = std::tuple_element_t<index, storage>;
+
+  template <size_t index>
+  static constexpr int slots = slot_count<function_type<index>>;
+
+  // only arguments that differ between overloads with the same slot count need checking
+  template <size_t index, size_t argument>
+  static consteval bool is_distinguishing() {
+    return []<size_t... i>(std::index_sequence<i...>) {
+      return !((slots<i> != slots<index> || shares_argument<function_type<index>, argument, function_type<i>>()) && ...);
+    }(std::index_sequence_for<function_types...>{});
+  }
+
+  // the last overload of a slot count is picked without any checks, it reports mismatches itself
+  template <size_t index>
+  static consteval bool is_last_candidate() {
+    return []<size_t... i>(std::index_sequence<i...>) {
+      return ((i <= index || slots<i> != slots<index>) && ...);
+    }(std::index_sequence_for<function_types...>{});
+  }
+
+  template <size_t index>
+  static consteval bool is_reachable() {
+    return []<size_t... i>(std::index_sequence<i...>) {
+      return ((i >= index || slots<i> != slots<index> || !shares_all_arguments<function_type<index>, function_type<i>>() ||
+               !shares_all_arguments<function_type<i>, function_type<index>>()) &&
+              ...);
+    }(std::index_sequence_for<function_types...>{});
+  }
+
+  template <size_t index, size_t argument, bool expensive>
+  MAAN_INLINE static bool check_argument(lua_State* state) {
+    using type = argument_type<function_type<index>, argument>;
+
+    if constexpr (!is_distinguishing<index, argument>() || is_expensive_check<type>() != expensive) {
+      return true;
+    } else if constexpr (aggregate::is_lua_convertable<type>) {
+      return aggregate::is<type>(state, argument_offset<function_type<index>, argument>() + 1);
+    } else {
+      return vm_types::is<type>(state, argument_offset<function_type<index>, argument>() + 1);
+    }
+  }
+
+  template <size_t index>
+  MAAN_INLINE static bool matches(lua_State* state) {
+    if constexpr (is_last_candidate<index>()) {
+      return true;
+    } else {
+      // type tag compares first, userdata hashes and aggregates after
+      return []<size_t... i>(lua_State* state, std::index_sequence<i...>) {
+        return (check_argument<index, i, false>(state) && ...) && (check_argument<index, i, true>(state) && ...);
+      }(state, std::make_index_sequence<argument_count<function_type<index>>>{});
+    }
+  }
+
+  static int dispatch(lua_State* state) {
+    auto* functions = static_cast<storage*>(lua_touserdata(state, lua_upvalueindex(1)));
+    const auto stack_size = operations::size(state);
+
+    auto result = -1;
+    [&]<size_t... i>(std::index_sequence<i...>) {
+      (void)((stack_size == slots<i> && matches<i>(state) && (result = invoke(state, std::get<i>(*functions)), true)) || ...);
+    }(std::index_sequence_for<function_types...>{});
+
+    if (result < 0) [[unlikely]] {
+      luaL_error(state, "no matching overload { stack_size: %d }", stack_size);
+      utilities::assume_unreachable();
+    }
+
+    return result;
+  }
+};
+} // namespace detail
+
+template <argument_check check = argument_check::checked>
 MAAN_INLINE void push(lua_State* state, is_function auto&& function) {
+  static constexpr auto checked = is_checked(check);
+
   using info = info<std::remove_cvref_t<decltype(function)>>;
 
   using ret_type = info::ret_type;
 
   static_assert(vm_types::is_lua_convertable<ret_type> || aggregate::is_lua_convertable<ret_type>, "wrapped function has unsupported return type");
 
+  if constexpr (is_callable<decltype(function)>) {
+    using callable_type = std::remove_cvref_t<decltype(function)>;
+
+    if constexpr (std::is_empty_v<callable_type> && std::is_default_constructible_v<callable_type>) {
+      lua_pushcclosure(state, detail::empty_callable_wrapper<callable_type, checked>, 0);
+    } else {
+      // aligned like the callable, its metatable runs the destructor once the closure is collected
+      vm_types::detail::emplace<callable_type>(state, std::forward<decltype(function)>(function));
+      lua_pushcclosure(state, detail::callable_wrapper<callable_type, checked>, 1);
+    }
+
+    return;
+  }
+
   struct call_info {
     std::remove_cvref_t<decltype(function)> ptr;
   };
@@ -127,34 +390,55 @@ MAAN_INLINE void push(lua_State* state, is_function auto&& function) {
   new (lua_newuserdata(state, call_info_size)) call_info{function};
 
   static lua_CFunction const call_wrapper = +[](lua_State* state) -> int {
-    static constexpr auto requirements = info::requirements;
+    detail::check_stack_size<std::remove_cvref_t<decltype(function)>, checked>(state);
 
-    if (const auto stack_size = operations::size(state); requirements.stack_slot_count != stack_size) {
-      luaL_error(state, "invalid arguments { expected: %d | stack_size: %d }", requirements.stack_slot_count, stack_size);
-      utilities::assume_unreachable();
-    }
+    auto* call = static_cast<call_info*>(lua_touserdata(state, lua_upvalueindex(1)));
+    return detail::invoke<checked>(state, call->ptr);
+  };
 
-    using tuple = info::tuple_type;
+  lua_pushcclosure(state, call_wrapper, 1);
+}
 
-    tuple params;
-    info::set_tuple(state, params);
+namespace detail {
+template <auto function, bool checked>
+int static_call_wrapper(lua_State* state) {
+  check_stack_size<decltype(function), checked>(state);
+  return invoke<checked>(state, function);
+}
+} // namespace detail
+
+// binds the function at compile time, the closure has no upvalue or userdata and calls it directly,
+// so the compiler can inline the function into the wrapper
+template <auto function, argument_check check = argument_check::checked>
+  requires is_function<decltype(function)>
+MAAN_INLINE void push(lua_State* state) {
+  using ret_type = info<decltype(function)>::ret_type;
+  static_assert(vm_types::is_lua_convertable<ret_type> || aggregate::is_lua_convertable<ret_type>, "wrapped function has unsupported return type");
 
-    const auto* call = static_cast<call_info*>(lua_touserdata(state, lua_upvalueindex(1)));
+  lua_pushcclosure(state, detail::static_call_wrapper<function, is_checked(check)>, 0);
+}
 
-    if constexpr (std::is_same_v<ret_type, void>) {
-      std::apply(call->ptr, std::move(params));
-      return 0;
-    } else {
-      if constexpr (aggregate::is_lua_convertable<ret_type>) {
-        aggregate::push(state, std::apply(call->ptr, std::move(params)));
-        return aggregate::stack_size<ret_type>();
-      } else {
-        vm_types::push(state, std::apply(call->ptr, std::move(params)));
-        return 1;
-      }
-    }
-  };
+// one closure for several signatures, the overload is picked by stack size first and then by checking
+// only the arguments that differ between overloads of the same size, in declaration order
+template <typename... function_types>
+  requires(sizeof...(function_types) != 0 && (is_function<function_types> && ...))
+MAAN_INLINE void push_overloads(lua_State* state, function_types... functions) {
+  using overload_set = detail::overload_set<std::remove_cvref_t<function_types>...>;
 
-  lua_pushcclosure(state, call_wrapper, 1);
+  static_assert(((vm_types::is_lua_convertable<typename info<function_types>::ret_type> ||
+                  aggregate::is_lua_convertable<typename info<function_types>::ret_type>) &&
+                 ...),
+                "wrapped function has unsupported return type");
+
+  static_assert([]<size_t... i>(std::index_sequence<i...>) { return (overload_set::template is_reachable<i>() && ...); }(
+                  std::index_sequence_for<function_types...>{}),
+                "overload can never be picked, an earlier overload takes the same arguments");
+
+  // the set is stored in a plain userdata without a metatable
+  static_assert(std::is_trivially_destructible_v<typename overload_set::storage> && alignof(typename overload_set::storage) <= alignof(double),
+                "overloads can only capture trivially destructible state with at most the alignment of a double");
+
+  new (lua_newuserdata(state, sizeof(typename overload_set::storage))) typename overload_set::storage{functions...};
+  lua_pushcclosure(state, overload_set::dispatch, 1);
 }
 } // namespace maan::native_function
\ No newline at end of file
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <string>
+
 #include <lua.hpp>
 #include <maan/utilities.hpp>
 #include <maan/vm_type_tag.hpp>
@@ -29,6 +34,11 @@ MAAN_INLINE inline int abs(lua_State* state, int const index) {
   return index;
 }
 
+// makes sure count more values can be pushed, growing the stack once if required
+MAAN_INLINE inline bool reserve(lua_State* state, int const count) {
+  return lua_checkstack(state, count) != 0;
+}
+
 MAAN_INLINE inline void pop(lua_State* state, int const index) {
   lua_settop(state, -index - 1);
 }
@@ -78,80 +88,256 @@ MAAN_INLINE inline void perform_gc_step(lua_State* state) {
   lua_gc(state, LUA_GCSTEP, step_ratio);
 }
 
+// returns true if the step finished a collection cycle
+MAAN_INLINE inline bool perform_gc_step(lua_State* state, int const step_size) {
+  return lua_gc(state, LUA_GCSTEP, step_size) != 0;
+}
+
+MAAN_INLINE inline size_t working_set_bytes(lua_State* state) {
+  return static_cast<size_t>(lua_gc(state, LUA_GCCOUNT, 0)) * 1024 + static_cast<size_t>(lua_gc(state, LUA_GCCOUNTB, 0));
+}
+
+// both return the previous value
+MAAN_INLINE inline int set_gc_pause(lua_State* state, int const pause) {
+  return lua_gc(state, LUA_GCSETPAUSE, pause);
+}
+
+MAAN_INLINE inline int set_gc_step_multiplier(lua_State* state, int const step_multiplier) {
+  return lua_gc(state, LUA_GCSETSTEPMUL, step_multiplier);
+}
+
+struct gc_report {
+  int steps;
+  bool cycle_finished;
+  std::chrono::nanoseconds elapsed;
+  size_t collected_bytes;
+};
+
+// performs incremental steps of step_size until the budget is used up or the current cycle finishes
+inline gc_report perform_gc_for(lua_State* state, std::chrono::nanoseconds const budget, int const step_size = 0) {
+  using clock = std::chrono::steady_clock;
+
+  const auto start = clock::now();
+  const auto bytes_before = working_set_bytes(state);
+
+  gc_report report{};
+  auto now = start;
+
+  do {
+    ++report.steps;
+    report.cycle_finished = perform_gc_step(state, step_size);
+    now = clock::now();
+  } while (!report.cycle_finished && now - start < budget);
+
+  const auto bytes_after = working_set_bytes(state);
+
+  report.elapsed = now - start;
+  report.collected_bytes = bytes_before > bytes_after ? bytes_before - bytes_after : 0;
+  return report;
+}
+
+enum class traceback_policy {
+  // format a full traceback into the error message inside the error handler
+  full,
+  // record the raw stack levels inside the error handler, formatting only happens in operations::traceback
+  lazy,
+  // run without an error handler
+  none,
+};
+
+namespace detail {
+inline constexpr char error_handler_key = 0;
+inline constexpr char traceback_key = 0;
+
+MAAN_INLINE inline void* key(char const& value) {
+  return const_cast<char*>(&value);
+}
+
+struct traceback_frame {
+  int current_line;
+  int line_defined;
+  char what;
+  char source[LUA_IDSIZE];
+};
+
+struct traceback_record {
+  static constexpr int maximum_depth = 16;
+
+  int depth;
+  bool truncated;
+  std::array<traceback_frame, maximum_depth> frames;
+};
+
+MAAN_INLINE inline traceback_record* find_traceback_record(lua_State* state) {
+  lua_pushlightuserdata(state, key(traceback_key));
+  lua_rawget(state, LUA_REGISTRYINDEX);
+  auto* record = static_cast<traceback_record*>(lua_touserdata(state, -1));
+  pop(state, 1);
+  return record;
+}
+} // namespace detail
+
 MAAN_INLINE inline int error_handler(lua_State* state) {
   luaL_traceback(state, state, lua_tolstring(state, -1, nullptr), 0);
   return 1;
 }
 
-MAAN_INLINE inline int pcall(lua_State* state, int const nargs, int const result_count) {
-  // expected stack layout:
-  // - params
-  // - chunk
+inline int lazy_error_handler(lua_State* state) {
+  auto* record = static_cast<detail::traceback_record*>(lua_touserdata(state, lua_upvalueindex(1)));
 
-  // determine the position of the error handler function
-  const auto error_function_pos = size(state) - nargs;
-  lua_pushcclosure(state, error_handler, 0);
+  lua_Debug info;
+  auto level = 1;
+  auto depth = 0;
 
-  // move error handler to the top of the stack
-  insert(state, error_function_pos);
+  while (depth < detail::traceback_record::maximum_depth && lua_getstack(state, level++, &info) != 0) {
+    lua_getinfo(state, "Sl", &info);
 
-  // expected stack layout:
-  // - params
-  // - chunk
-  // - error handler
+    auto& frame = record->frames[depth++];
+    frame.current_line = info.currentline;
+    frame.line_defined = info.linedefined;
+    frame.what = info.what != nullptr ? info.what[0] : '?';
+    std::memcpy(frame.source, info.short_src, sizeof(frame.source));
+  }
 
-  if (const auto result = lua_pcall(state, nargs, result_count, error_function_pos); result == 0) [[likely]]
-  {
-    remove(state, error_function_pos);
-    return result_count == LUA_MULTRET ? size(state) : result_count;
+  record->depth = depth;
+  record->truncated = lua_getstack(state, level, &info) != 0;
+
+  // the error message is passed through untouched
+  return 1;
+}
+
+MAAN_INLINE inline void set_traceback_policy(lua_State* state, traceback_policy const policy) {
+  lua_pushlightuserdata(state, detail::key(detail::traceback_key));
+  if (policy == traceback_policy::lazy) {
+    new (lua_newuserdata(state, sizeof(detail::traceback_record))) detail::traceback_record{};
   } else {
-    switch (result) {
-    case LUA_ERRRUN: {
-      remove(state, error_function_pos);
-      return -1;
+    lua_pushnil(state);
+  }
+  lua_rawset(state, LUA_REGISTRYINDEX);
+
+  lua_pushlightuserdata(state, detail::key(detail::error_handler_key));
+  switch (policy) {
+  case traceback_policy::full: {
+    lua_pushcclosure(state, error_handler, 0);
+    break;
+  }
+  case traceback_policy::lazy: {
+    lua_pushlightuserdata(state, detail::key(detail::traceback_key));
+    lua_rawget(state, LUA_REGISTRYINDEX);
+    lua_pushcclosure(state, lazy_error_handler, 1);
+    break;
+  }
+  case traceback_policy::none: {
+    lua_pushboolean(state, 0);
+    break;
+  }
+  default: {
+    utilities::assume_unreachable();
+  }
+  }
+  lua_rawset(state, LUA_REGISTRYINDEX);
+}
+
+// formats the stack levels recorded by the last error handled with traceback_policy::lazy
+[[nodiscard]] inline std::string traceback(lua_State* state) {
+  const auto* record = detail::find_traceback_record(state);
+  if (record == nullptr) {
+    return {};
+  }
+
+  std::string result = "stack traceback:";
+  for (auto i = 0; i < record->depth; ++i) {
+    const auto& frame = record->frames[i];
+
+    result += "\n\t";
+    result += frame.source;
+    result += ':';
+    if (frame.current_line > 0) {
+      result += std::to_string(frame.current_line);
+      result += ':';
     }
-    case LUA_ERRMEM: {
-      clear(state);
-      return -2;
+
+    switch (frame.what) {
+    case 'm': {
+      result += " in main chunk";
+      break;
     }
-    case LUA_ERRERR: {
-      clear(state);
-      return -3;
+    case 'C': {
+      result += " ?";
+      break;
     }
     default: {
-      utilities::assume_unreachable();
+      result += " in function <";
+      result += frame.source;
+      result += ':';
+      result += std::to_string(frame.line_defined);
+      result += '>';
+      break;
     }
     }
   }
+
+  if (record->truncated) {
+    result += "\n\t...";
+  }
+
+  return result;
 }
 
-MAAN_INLINE inline int pcall(lua_State* state, int const nargs) {
-  const auto stack_size = size(state);
+// pushes the cached error handler, returning its position or 0 if the vm runs without one
+MAAN_INLINE inline int push_error_handler(lua_State* state) {
+  lua_pushlightuserdata(state, detail::key(detail::error_handler_key));
+  lua_rawget(state, LUA_REGISTRYINDEX);
 
-  // expected stack layout:
-  // - params
-  // - chunk
+  if (is(state, -1, vm_type_tag::function)) [[likely]] {
+    return size(state);
+  }
 
-  // determine the position of the error handler function
-  const auto error_function_pos = size(state) - nargs;
-  lua_pushcclosure(state, error_handler, 0);
+  const auto is_unset = is(state, -1, vm_type_tag::nil);
+  pop(state, 1);
+
+  if (is_unset) {
+    set_traceback_policy(state, traceback_policy::full);
+    return push_error_handler(state);
+  }
 
-  // move error handler to the top of the stack
-  insert(state, error_function_pos);
+  return 0;
+}
+
+// places the cached error handler below the function at function_pos, returning its position or 0.
+// everything above function_pos moves up a slot, prefer pushing the handler before the function where possible
+MAAN_INLINE inline int insert_error_handler(lua_State* state, int const function_pos) {
+  if (push_error_handler(state) == 0) {
+    return 0;
+  }
 
+  insert(state, function_pos);
+  return function_pos;
+}
+
+MAAN_INLINE inline int pcall(lua_State* state, int const nargs, int const result_count, int const error_function_pos) {
   // expected stack layout:
   // - params
   // - chunk
-  // - error handler
+  // - error handler (if error_function_pos isn't 0)
+
+  const auto function_pos = size(state) - nargs;
 
-  if (const auto result = lua_pcall(state, nargs, LUA_MULTRET, error_function_pos); result == 0) [[likely]]
+  if (const auto result = lua_pcall(state, nargs, result_count, error_function_pos); result == 0) [[likely]]
   {
-    remove(state, error_function_pos);
-    return size(state) - (stack_size - 1 - nargs);
+    const auto count = result_count == LUA_MULTRET ? size(state) - function_pos + 1 : result_count;
+
+    if (error_function_pos != 0) {
+      remove(state, error_function_pos);
+    }
+
+    return count;
   } else {
     switch (result) {
     case LUA_ERRRUN: {
-      remove(state, error_function_pos);
+      if (error_function_pos != 0) {
+        remove(state, error_function_pos);
+      }
       return -1;
     }
     case LUA_ERRMEM: {
@@ -169,6 +355,19 @@ MAAN_INLINE inline int pcall(lua_State* state, int const nargs) {
   }
 }
 
+MAAN_INLINE inline int pcall(lua_State* state, int const nargs, int const result_count) {
+  // expected stack layout:
+  // - params
+  // - chunk
+
+  const auto error_function_pos = insert_error_handler(state, size(state) - nargs);
+  return pcall(state, nargs, result_count, error_function_pos);
+}
+
+MAAN_INLINE inline int pcall(lua_State* state, int const nargs) {
+  return pcall(state, nargs, LUA_MULTRET);
+}
+
 MAAN_INLINE inline int pcall(lua_State* state) {
   return pcall(state, size(state) - 1);
 }
@@ -192,28 +391,41 @@ MAAN_INLINE inline int load(lua_State* state, const char* name, const char* code
   }
 }
 
+MAAN_INLINE inline int set_environment(lua_State* state, int const env_table_index) {
+  copy(state, env_table_index);
+  return lua_setfenv(state, -2) ? 0 : -4;
+}
+
 MAAN_INLINE inline int load(lua_State* state, const char* name, const char* code, size_t const size, int const env_table_index) {
   if (const auto result = load(state, name, code, size); result == LUA_OK) {
-    copy(state, env_table_index);
-    return lua_setfenv(state, -2) ? 0 : -4;
+    return set_environment(state, env_table_index);
   } else {
     return result;
   }
 }
 
-MAAN_INLINE inline int execute(lua_State* state, const char* name, const char* code, size_t const size) {
-  if (const auto result = load(state, name, code, size); result == 0) {
-    return pcall(state, 0);
+// runs the chunk loaded by load_chunk with the error handler pushed before it, so nothing has to be moved below the chunk
+MAAN_INLINE inline int execute_loaded(lua_State* state, auto&& load_chunk) {
+  const auto error_function_pos = push_error_handler(state);
+
+  if (const auto result = load_chunk(); result == 0) {
+    return pcall(state, 0, LUA_MULTRET, error_function_pos);
   } else {
+    // memory errors already cleared the stack, anything else leaves its message or the chunk above the handler
+    if (result != -2 && error_function_pos != 0) {
+      remove(state, error_function_pos);
+    }
+
     return result;
   }
 }
 
+MAAN_INLINE inline int execute(lua_State* state, const char* name, const char* code, size_t const size) {
+  return execute_loaded(state, [&] { return load(state, name, code, size); });
+}
+
 MAAN_INLINE inline int execute(lua_State* state, const char* name, const char* code, size_t const size, int const env_table_index) {
-  if (const auto result = load(state, name, code, size, env_table_index); result == 0) {
-    return pcall(state, 0);
-  } else {
-    return result;
-  }
+  const auto env_pos = abs(state, env_table_index);
+  return execute_loaded(state, [&] { return load(state, name, code, size, env_pos); });
 }
 } // namespace maan::operations
\ No newline at end of file
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <maan/vm.hpp>
+
+namespace maan::parallel {
+// item index used for errors that happen while a worker sets up its vm
+inline constexpr size_t no_item = std::numeric_limits<size_t>::max();
+
+struct options {
+  // 0 uses std::thread::hardware_concurrency
+  size_t worker_count = 0;
+
+  // 0 picks a chunk size that gives every worker around 16 chunks
+  size_t chunk_size = 0;
+
+  // runs on every worker vm before the script, e.g. to register native functions
+  std::function<void(vm&)> init;
+};
+
+struct worker_statistics {
+  size_t items;
+  size_t steals;
+  std::chrono::nanoseconds elapsed;
+
+  [[nodiscard]] double throughput() const {
+    const auto seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds == 0. ? 0. : static_cast<double>(items) / seconds;
+  }
+};
+
+template <typename T>
+struct result {
+  std::vector<T> values;
+  std::vector<call_error> errors;
+  std::vector<worker_statistics> workers;
+
+  [[nodiscard]] bool ok() const {
+    return errors.empty();
+  }
+};
+
+template <>
+struct result<void> {
+  std::vector<call_error> errors;
+  std::vector<worker_statistics> workers;
+
+  [[nodiscard]] bool ok() const {
+    return errors.empty();
+  }
+};
+
+namespace detail {
+// a [begin, end) range of item indices packed into one word, so owners and thieves can claim from it with a single cas.
+// the owner takes chunks from the front, thieves take half of what is left from the back
+class alignas(64) work_range {
+  std::atomic<uint64_t> packed{};
+
+  [[nodiscard]] MAAN_INLINE static constexpr uint64_t pack(uint32_t const begin, uint32_t const end) {
+    return static_cast<uint64_t>(begin) << 32 | end;
+  }
+
+  [[nodiscard]] MAAN_INLINE static constexpr uint32_t begin_of(uint64_t const value) {
+    return static_cast<uint32_t>(value >> 32);
+  }
+
+  [[nodiscard]] MAAN_INLINE static constexpr uint32_t end_of(uint64_t const value) {
+    return static_cast<uint32_t>(value);
+  }
+
+public:
+  struct chunk {
+    uint32_t begin;
+    uint32_t end;
+
+    [[nodiscard]] bool empty() const {
+      return begin == end;
+    }
+  };
+
+  // only the owner assigns, and only while the range is empty so no thief can be claiming from it
+  MAAN_INLINE void assign(uint32_t const begin, uint32_t const end) {
+    packed.store(pack(begin, end), std::memory_order_release);
+  }
+
+  [[nodiscard]] MAAN_INLINE chunk take(uint32_t const size) {
+    auto value = packed.load(std::memory_order_acquire);
+
+    while (true) {
+      const auto begin = begin_of(value);
+      const auto end = end_of(value);
+      if (begin == end) {
+        return {begin, end};
+      }
+
+      const auto next = static_cast<uint32_t>(std::min<uint64_t>(end, static_cast<uint64_t>(begin) + size));
+      if (packed.compare_exchange_weak(value, pack(next, end), std::memory_order_acq_rel)) {
+        return {begin, next};
+      }
+    }
+  }
+
+  [[nodiscard]] MAAN_INLINE chunk steal() {
+    auto value = packed.load(std::memory_order_acquire);
+
+    while (true) {
+      const auto begin = begin_of(value);
+      const auto end = end_of(value);
+      if (begin == end) {
+        return {begin, end};
+      }
+
+      const auto middle = begin + (end - begin) / 2;
+      if (packed.compare_exchange_weak(value, pack(begin, middle), std::memory_order_acq_rel)) {
+        return {middle, end};
+      }
+    }
+  }
+};
+
+struct worker_state {
+  size_t items = 0;
+  size_t steals = 0;
+  std::chrono::nanoseconds elapsed{};
+  std::vector<call_error> errors;
+};
+
+MAAN_INLINE inline void record_error(lua_State* state, worker_state& worker, size_t const index, int const code) {
+  // only runtime and syntax errors leave a message, the others clear the stack
+  const auto* message = code == -1 && operations::size(state) != 0 ? lua_tostring(state, -1) : nullptr;
+  worker.errors.push_back({index, code, message != nullptr ? message : std::string{}});
+}
+
+// creates the worker vm, runs the script and leaves the entry function on top of the stack
+MAAN_INLINE inline bool prepare(vm& instance, worker_state& worker, std::string_view const code, const char* entry, options const& config) {
+  auto* state = instance.get_state();
+  if (state == nullptr) [[unlikely]] {
+    worker.errors.push_back({no_item, -2, "failed to create vm"});
+    return false;
+  }
+
+  if (config.init) {
+    config.init(instance);
+    operations::clear(state);
+  }
+
+  if (const auto status = instance.execute("parallel", code); status < 0) {
+    record_error(state, worker, no_item, status);
+    return false;
+  }
+
+  operations::clear(state);
+  lua_getfield(state, LUA_GLOBALSINDEX, entry);
+
+  if (!operations::is(state, -1, vm_type_tag::function)) {
+    worker.errors.push_back({no_item, -1, std::string{"entry function '"} + entry + "' not found"});
+    return false;
+  }
+
+  return true;
+}
+
+// claims chunks from the worker's own range first and steals from the others once it runs dry
+template <typename fn_type>
+MAAN_INLINE void drain(std::span<work_range> ranges, size_t const self, uint32_t const chunk_size, worker_state& worker, fn_type&& process) {
+  auto& own = ranges[self];
+
+  while (true) {
+    for (auto chunk = own.take(chunk_size); !chunk.empty(); chunk = own.take(chunk_size)) {
+      for (auto i = chunk.begin; i < chunk.end; ++i) {
+        process(i);
+      }
+
+      worker.items += chunk.end - chunk.begin;
+    }
+
+    auto stolen = work_range::chunk{};
+    for (size_t offset = 1; offset < ranges.size() && stolen.empty(); ++offset) {
+      stolen = ranges[(self + offset) % ranges.size()].steal();
+    }
+
+    if (stolen.empty()) {
+      return;
+    }
+
+    ++worker.steals;
+    own.assign(stolen.begin, stolen.end);
+  }
+}
+
+template <typename In, typename fn_type>
+MAAN_INLINE std::vector<worker_state> run(std::string_view const code, const char* entry, std::span<In const> inputs, options const& config, fn_type&& process) {
+  if (inputs.size() >= std::numeric_limits<uint32_t>::max()) [[unlikely]] {
+    auto workers = std::vector<worker_state>(1);
+    workers.front().errors.push_back({no_item, -1, "too many inputs"});
+    return workers;
+  }
+
+  const auto hardware_workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+  const auto worker_count = std::max<size_t>(1, std::min(config.worker_count != 0 ? config.worker_count : hardware_workers, inputs.size()));
+  const auto chunk_size = static_cast<uint32_t>(config.chunk_size != 0 ? config.chunk_size : std::max<size_t>(1, inputs.size() / (worker_count * 16)));
+
+  auto ranges = std::make_unique<work_range[]>(worker_count);
+  for (size_t i = 0; i < worker_count; ++i) {
+    ranges[i].assign(static_cast<uint32_t>(inputs.size() * i / worker_count), static_cast<uint32_t>(inputs.size() * (i + 1) / worker_count));
+  }
+
+  auto workers = std::vector<worker_state>(worker_count);
+
+  {
+    auto threads = std::vector<std::jthread>{};
+    threads.reserve(worker_count);
+
+    for (size_t self = 0; self < worker_count; ++self) {
+      threads.emplace_back([&, self] {
+        auto& worker = workers[self];
+
+        // vms that fail to set up leave their range to be stolen by the others
+        auto instance = vm{};
+        if (!prepare(instance, worker, code, entry, config)) {
+          return;
+        }
+
+        auto* state = instance.get_state();
+        const auto start = std::chrono::steady_clock::now();
+
+        drain(std::span{ranges.get(), worker_count}, self, chunk_size, worker, [&](uint32_t const index) {
+          process(state, worker, index, inputs[index]);
+
+          // memory errors clear the whole stack including the entry function
+          if (operations::size(state) == 0) [[unlikely]] {
+            lua_getfield(state, LUA_GLOBALSINDEX, entry);
+          } else {
+            lua_settop(state, 1);
+          }
+        });
+
+        worker.elapsed = std::chrono::steady_clock::now() - start;
+      });
+    }
+  }
+
+  return workers;
+}
+
+template <typename T>
+MAAN_INLINE void collect(result<T>& output, std::vector<worker_state>& workers) {
+  output.workers.reserve(workers.size());
+
+  for (auto& worker : workers) {
+    output.workers.push_back({worker.items, worker.steals, worker.elapsed});
+    output.errors.insert(output.errors.end(), std::make_move_iterator(worker.errors.begin()), std::make_move_iterator(worker.errors.end()));
+  }
+
+  std::ranges::sort(output.errors, {}, &call_error::index);
+}
+} // namespace detail
+} // namespace maan::parallel
+
+namespace maan {
+// runs the global function entry defined by code over every input on a work stealing pool of vms, one per worker.
+// every worker loads code into its own vm, so entry should not depend on state shared between calls.
+// item indices are 32 bit, larger inputs are rejected with an error.
+// values of items that failed keep their default value and are listed in errors
+template <typename Out, typename In>
+[[nodiscard]] parallel::result<Out> parallel_map(std::string_view const code, const char* entry, std::span<In const> const inputs,
+                                                parallel::options const& config = {}) {
+  static_assert(std::is_default_constructible_v<Out>, "parallel_map results have to be default constructible");
+  static constexpr auto result_count = stack::slot_count<Out>();
+
+  auto output = parallel::result<Out>{};
+  if (inputs.empty()) {
+    return output;
+  }
+
+  // written by index from all workers, so this can't be a std::vector<bool>
+  auto values = std::make_unique<Out[]>(inputs.size());
+
+  auto workers = parallel::detail::run(code, entry, inputs, config, [&](lua_State* state, auto& worker, size_t const index, In const& input) {
+    if (const auto status = stack::call_at<result_count>(state, 1, input); status < 0) [[unlikely]] {
+      parallel::detail::record_error(state, worker, index, status);
+      return;
+    }
+
+    values[index] = stack::get<Out>(state, -result_count);
+  });
+
+  output.values.assign(std::make_move_iterator(values.get()), std::make_move_iterator(values.get() + inputs.size()));
+  parallel::detail::collect(output, workers);
+  return output;
+}
+
+// like parallel_map but discards whatever entry returns
+template <typename In>
+parallel::result<void> parallel_for(std::string_view const code, const char* entry, std::span<In const> const inputs, parallel::options const& config = {}) {
+  auto output = parallel::result<void>{};
+  if (inputs.empty()) {
+    return output;
+  }
+
+  auto workers = parallel::detail::run(code, entry, inputs, config, [&](lua_State* state, auto& worker, size_t const index, In const& input) {
+    if (const auto status = stack::call_at<0>(state, 1, input); status < 0) [[unlikely]] {
+      parallel::detail::record_error(state, worker, index, status);
+    }
+  });
+
+  parallel::detail::collect(output, workers);
+  return output;
+}
+} // namespace maan
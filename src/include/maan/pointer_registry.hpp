@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <lua.hpp>
+#include <maan/utilities.hpp>
+
+namespace maan::pointer_registry {
+namespace detail {
+struct range {
+  std::uintptr_t begin;
+  std::uintptr_t end;
+  std::uintptr_t stride;
+  std::uint32_t hash;
+};
+
+// light userdata carries no type information, so the type of a pointer is recovered by
+// looking up the address range it was registered with
+class registry {
+  std::vector<range> ranges;
+
+public:
+  [[nodiscard]] MAAN_INLINE const range* find(std::uintptr_t const address) const {
+    const auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](auto const value, auto const& entry) { return value < entry.begin; });
+
+    if (it == ranges.begin()) {
+      return nullptr;
+    }
+
+    const auto& entry = *std::prev(it);
+    if (address >= entry.end || (address - entry.begin) % entry.stride != 0) {
+      return nullptr;
+    }
+
+    return &entry;
+  }
+
+  MAAN_INLINE void add(range const& entry) {
+    const auto it = std::upper_bound(ranges.begin(), ranges.end(), entry.begin, [](auto const value, auto const& other) { return value < other.begin; });
+    ranges.insert(it, entry);
+  }
+
+  MAAN_INLINE bool remove(std::uintptr_t const begin) {
+    const auto it = std::find_if(ranges.begin(), ranges.end(), [begin](auto const& entry) { return entry.begin == begin; });
+
+    if (it == ranges.end()) {
+      return false;
+    }
+
+    ranges.erase(it);
+    return true;
+  }
+};
+
+inline constexpr char registry_key = 0;
+
+MAAN_INLINE inline void* key() {
+  return const_cast<char*>(&registry_key);
+}
+
+MAAN_INLINE inline registry* find(lua_State* state) {
+  lua_pushlightuserdata(state, key());
+  lua_rawget(state, LUA_REGISTRYINDEX);
+  auto* result = static_cast<registry*>(lua_touserdata(state, -1));
+  lua_settop(state, -2);
+  return result;
+}
+
+MAAN_INLINE inline registry& acquire(lua_State* state) {
+  if (auto* result = find(state); result != nullptr) {
+    return *result;
+  }
+
+  lua_pushlightuserdata(state, key());
+  auto* result = new (lua_newuserdata(state, sizeof(registry))) registry{};
+
+  lua_createtable(state, 0, 1);
+  lua_pushcclosure(
+    state,
+    +[](lua_State* state) -> int {
+      static_cast<registry*>(lua_touserdata(state, 1))->~registry();
+      return 0;
+    },
+    0);
+  lua_setfield(state, -2, "__gc");
+  lua_setmetatable(state, -2);
+
+  lua_rawset(state, LUA_REGISTRYINDEX);
+  return *result;
+}
+} // namespace detail
+
+// registers [begin, begin + count) as holding objects of type T, pointers into it
+// that are passed to the vm as light userdata can then be checked with vm_types::is
+template <typename T>
+MAAN_INLINE void add(lua_State* state, T const* begin, size_t const count = 1) {
+  using type = std::remove_cv_t<T>;
+
+  const auto address = reinterpret_cast<std::uintptr_t>(begin);
+  detail::acquire(state).add({address, address + count * sizeof(type), sizeof(type), utilities::type_tag<type*>::hash()});
+}
+
+MAAN_INLINE inline bool remove(lua_State* state, void const* begin) {
+  auto* registry = detail::find(state);
+  return registry != nullptr && registry->remove(reinterpret_cast<std::uintptr_t>(begin));
+}
+
+template <typename T>
+[[nodiscard]] MAAN_INLINE bool is(lua_State* state, void const* address) {
+  const auto* registry = detail::find(state);
+  if (registry == nullptr) [[unlikely]] {
+    return false;
+  }
+
+  const auto* entry = registry->find(reinterpret_cast<std::uintptr_t>(address));
+  return entry != nullptr && entry->hash == utilities::type_tag<std::remove_cv_t<T>*>::hash();
+}
+} // namespace maan::pointer_registry
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <maan/vm.hpp>
+
+#if defined(LUAJIT_VERSION_NUM) && LUAJIT_VERSION_NUM >= 20100
+#define MAAN_HAS_JIT_PROFILER 1
+#else
+#define MAAN_HAS_JIT_PROFILER 0
+#endif
+
+namespace maan::profiling {
+// where the vm was when a sample was taken, these follow the vm states luaJIT_profile reports
+enum class category : uint8_t {
+  interpreted,
+  compiled,
+  c,
+  gc,
+  compiler,
+};
+
+inline constexpr size_t category_count = 5;
+
+enum class backend {
+  none,
+  // luaJIT_profile_start, a timer based sampler that sees every vm state
+  sampler,
+  // a lua_sethook count hook, it only fires while interpreting
+  hook,
+};
+
+struct options {
+  // milliseconds between samples of the sampler
+  int interval = 1;
+
+  // vm instructions between samples of the hook
+  int hook_instructions = 1000;
+
+  // frames kept per sample, counted from the innermost one
+  int depth = 32;
+
+  // skips the sampler even when it is available
+  bool force_hook = false;
+};
+
+[[nodiscard]] MAAN_INLINE constexpr std::string_view name(category const value) {
+  switch (value) {
+  case category::interpreted:
+    return "interpreted";
+  case category::compiled:
+    return "compiled";
+  case category::c:
+    return "c";
+  case category::gc:
+    return "gc";
+  case category::compiler:
+    return "compiler";
+  }
+
+  return "unknown";
+}
+
+namespace detail {
+inline constexpr int maximum_depth = 64;
+inline constexpr size_t maximum_stack_length = 500;
+
+struct sample {
+  uint32_t count;
+  category where;
+  uint16_t length;
+  std::array<char, maximum_stack_length> stack;
+};
+
+// single producer single consumer ring, the vm thread writes samples in place and one reader drains them
+template <typename T, size_t capacity>
+class ring {
+  static_assert(std::has_single_bit(capacity), "the ring capacity has to be a power of two");
+
+  static constexpr size_t mask = capacity - 1;
+
+  std::array<T, capacity> slots{};
+  alignas(64) std::atomic<size_t> head{};
+  alignas(64) std::atomic<size_t> tail{};
+
+public:
+  // the next free slot or nullptr when the ring is full, the slot becomes visible to the reader with publish
+  [[nodiscard]] MAAN_INLINE T* acquire() {
+    const auto current = head.load(std::memory_order_relaxed);
+    if (current - tail.load(std::memory_order_acquire) == capacity) {
+      return nullptr;
+    }
+
+    return &slots[current & mask];
+  }
+
+  MAAN_INLINE void publish() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  MAAN_INLINE size_t drain(auto&& fn) {
+    const auto begin = tail.load(std::memory_order_relaxed);
+    const auto end = head.load(std::memory_order_acquire);
+
+    for (auto current = begin; current != end; ++current) {
+      fn(slots[current & mask]);
+    }
+
+    tail.store(end, std::memory_order_release);
+    return end - begin;
+  }
+};
+
+// the registry key the hook uses to find the profiler of its vm
+inline char hook_key{};
+
+[[nodiscard]] MAAN_INLINE constexpr category category_of(int const vmstate) {
+  switch (vmstate) {
+  case 'N':
+    return category::compiled;
+  case 'C':
+    return category::c;
+  case 'G':
+    return category::gc;
+  case 'J':
+    return category::compiler;
+  default:
+    return category::interpreted;
+  }
+}
+
+// cuts a stack that doesn't fit at the last complete frame
+[[nodiscard]] MAAN_INLINE inline size_t fit(const char* stack, size_t const length) {
+  if (length <= maximum_stack_length) {
+    return length;
+  }
+
+  const auto view = std::string_view{stack, maximum_stack_length};
+  const auto last = view.rfind(';');
+  return last == std::string_view::npos ? maximum_stack_length : last;
+}
+
+// names a Lua frame by its chunk like luaJIT_profile_dumpstack does for "pF", C frames get their name or [C] instead of
+// dumpstack's [builtin#N] and @address
+MAAN_INLINE inline int write_frame(lua_Debug const& frame, std::array<char, LUA_IDSIZE + 64>& text) {
+  if (frame.what != nullptr && frame.what[0] == 'C') {
+    return std::snprintf(text.data(), text.size(), "%s", frame.name != nullptr ? frame.name : "[C]");
+  }
+
+  // "=name" and "@file" chunks keep their name, chunks loaded from a string are all called [string]
+  const auto* chunk = frame.source != nullptr && (frame.source[0] == '=' || frame.source[0] == '@') ? frame.source + 1 : "[string]";
+
+  return frame.name != nullptr ? std::snprintf(text.data(), text.size(), "%s:%s", chunk, frame.name)
+                               : std::snprintf(text.data(), text.size(), "%s:%d", chunk, frame.linedefined);
+}
+
+// writes the stack outermost frame first with frames separated by ';'
+MAAN_INLINE inline uint16_t write_stack(lua_State* state, int const depth, std::array<char, maximum_stack_length>& buffer) {
+  std::array<lua_Debug, maximum_depth> frames;
+
+  auto frame_count = 0;
+  while (frame_count < depth && lua_getstack(state, frame_count, &frames[frame_count]) != 0) {
+    lua_getinfo(state, "Sn", &frames[frame_count]);
+    ++frame_count;
+  }
+
+  size_t length = 0;
+  for (auto i = frame_count - 1; i >= 0; --i) {
+    auto text = std::array<char, LUA_IDSIZE + 64>{};
+    const auto written = write_frame(frames[i], text);
+    const auto size = std::min(static_cast<size_t>(std::max(written, 0)), text.size() - 1);
+    const auto separator = length == 0 ? 0 : 1;
+
+    if (length + separator + size > maximum_stack_length) {
+      break;
+    }
+
+    if (separator != 0) {
+      buffer[length++] = ';';
+    }
+
+    std::memcpy(buffer.data() + length, text.data(), size);
+    length += size;
+  }
+
+  return static_cast<uint16_t>(length);
+}
+} // namespace detail
+} // namespace maan::profiling
+
+namespace maan {
+// samples where a vm spends its time and aggregates the stacks for flamegraph tools.
+// it costs nothing until started, start and stop belong to the thread running the vm while collect, folded and the counters
+// can be read by one other thread at a time. luaJIT_profile is process wide, a second profiler started while one samples falls
+// back to the hook. the hook is shared by every thread of the vm and stands in for a hook set through debug.sethook until stop
+// puts that one back
+class profiler {
+  static constexpr size_t ring_capacity = 1024;
+
+  using ring_type = profiling::detail::ring<profiling::detail::sample, ring_capacity>;
+
+  lua_State* state;
+  profiling::backend active = profiling::backend::none;
+  int depth = 32;
+
+  // created by the first start, the reader only sees it once it's complete
+  std::unique_ptr<ring_type> ring_storage;
+  std::atomic<ring_type*> ring{};
+
+  lua_Hook previous_hook = nullptr;
+  int previous_mask = 0;
+  int previous_count = 0;
+
+  std::atomic<size_t> dropped_count{};
+  std::array<size_t, profiling::category_count> totals{};
+  std::unordered_map<std::string, size_t> stacks;
+
+  inline static std::atomic<profiler*> sampling_owner{};
+
+  MAAN_INLINE profiling::detail::sample* acquire(int const count) {
+    auto* slot = ring_storage->acquire();
+    if (slot == nullptr) [[unlikely]] {
+      dropped_count.fetch_add(static_cast<size_t>(count), std::memory_order_relaxed);
+    }
+
+    return slot;
+  }
+
+#if MAAN_HAS_JIT_PROFILER
+  static void sample(void* data, lua_State* thread, int const count, int const vmstate) {
+    auto* self = static_cast<profiler*>(data);
+
+    auto* slot = self->acquire(count);
+    if (slot == nullptr) {
+      return;
+    }
+
+    size_t length = 0;
+    const auto* stack = luaJIT_profile_dumpstack(thread, "pF;", -self->depth, &length);
+
+    // every frame ends with the separator
+    if (length > 0 && stack[length - 1] == ';') {
+      --length;
+    }
+
+    length = profiling::detail::fit(stack, length);
+    std::memcpy(slot->stack.data(), stack, length);
+
+    slot->count = static_cast<uint32_t>(count);
+    slot->where = profiling::detail::category_of(vmstate);
+    slot->length = static_cast<uint16_t>(length);
+    self->ring_storage->publish();
+  }
+#endif
+
+  static void hook(lua_State* thread, lua_Debug*) {
+    lua_pushlightuserdata(thread, &profiling::detail::hook_key);
+    lua_rawget(thread, LUA_REGISTRYINDEX);
+    auto* self = static_cast<profiler*>(lua_touserdata(thread, -1));
+    lua_settop(thread, -2);
+
+    if (self == nullptr) [[unlikely]] {
+      return;
+    }
+
+    auto* slot = self->acquire(1);
+    if (slot == nullptr) {
+      return;
+    }
+
+    slot->count = 1;
+    slot->where = profiling::category::interpreted;
+    slot->length = profiling::detail::write_stack(thread, self->depth, slot->stack);
+    self->ring_storage->publish();
+  }
+
+public:
+  MAAN_INLINE explicit profiler(lua_State* state) : state{state} {}
+
+  MAAN_INLINE explicit profiler(vm const& target) : profiler(target.get_state()) {}
+
+  MAAN_INLINE ~profiler() {
+    stop();
+  }
+
+  // the sampler and the hook keep a pointer to the profiler
+  profiler(profiler const&) = delete;
+  profiler& operator=(profiler const&) = delete;
+
+  // returns the backend that is sampling, starting a running profiler again keeps its backend
+  MAAN_INLINE profiling::backend start(profiling::options const& settings = {}) {
+    if (active != profiling::backend::none) {
+      return active;
+    }
+
+    depth = std::clamp(settings.depth, 1, profiling::detail::maximum_depth);
+
+    if (ring_storage == nullptr) {
+      ring_storage = std::make_unique<ring_type>();
+      ring.store(ring_storage.get(), std::memory_order_release);
+    }
+
+#if MAAN_HAS_JIT_PROFILER
+    profiler* expected = nullptr;
+    if (!settings.force_hook && sampling_owner.compare_exchange_strong(expected, this)) {
+      auto mode = std::array<char, 16>{};
+      std::snprintf(mode.data(), mode.size(), "i%d", std::max(settings.interval, 1));
+
+      luaJIT_profile_start(state, mode.data(), sample, this);
+      active = profiling::backend::sampler;
+      return active;
+    }
+#endif
+
+    lua_pushlightuserdata(state, &profiling::detail::hook_key);
+    lua_pushlightuserdata(state, this);
+    lua_rawset(state, LUA_REGISTRYINDEX);
+
+    previous_hook = lua_gethook(state);
+    previous_mask = lua_gethookmask(state);
+    previous_count = lua_gethookcount(state);
+
+    lua_sethook(state, hook, LUA_MASKCOUNT, std::max(settings.hook_instructions, 1));
+    active = profiling::backend::hook;
+    return active;
+  }
+
+  MAAN_INLINE void stop() {
+    switch (active) {
+    case profiling::backend::sampler: {
+#if MAAN_HAS_JIT_PROFILER
+      luaJIT_profile_stop(state);
+      sampling_owner.store(nullptr);
+#endif
+      break;
+    }
+    case profiling::backend::hook: {
+      lua_sethook(state, std::exchange(previous_hook, nullptr), std::exchange(previous_mask, 0), std::exchange(previous_count, 0));
+
+      lua_pushlightuserdata(state, &profiling::detail::hook_key);
+      lua_pushnil(state);
+      lua_rawset(state, LUA_REGISTRYINDEX);
+      break;
+    }
+    case profiling::backend::none:
+      break;
+    }
+
+    active = profiling::backend::none;
+  }
+
+  [[nodiscard]] MAAN_INLINE bool running() const {
+    return active != profiling::backend::none;
+  }
+
+  [[nodiscard]] MAAN_INLINE profiling::backend get_backend() const {
+    return active;
+  }
+
+  // moves the pending samples into the profile, returns how many were moved
+  MAAN_INLINE size_t collect() {
+    auto* pending = ring.load(std::memory_order_acquire);
+    if (pending == nullptr) {
+      return 0;
+    }
+
+    return pending->drain([this](profiling::detail::sample const& entry) {
+      totals[static_cast<size_t>(entry.where)] += entry.count;
+
+      auto key = std::string{profiling::name(entry.where)};
+      if (entry.length > 0) {
+        key += ';';
+        key.append(entry.stack.data(), entry.length);
+      }
+
+      stacks[std::move(key)] += entry.count;
+    });
+  }
+
+  // the profile in the folded format flamegraph tools read, one "category;outer;...;inner count" line per stack
+  [[nodiscard]] MAAN_INLINE std::string folded() {
+    collect();
+
+    auto result = std::string{};
+    for (auto const& [stack, count] : stacks) {
+      result += stack;
+      result += ' ';
+      result += std::to_string(count);
+      result += '\n';
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] MAAN_INLINE size_t samples(profiling::category const where) const {
+    return totals[static_cast<size_t>(where)];
+  }
+
+  [[nodiscard]] MAAN_INLINE size_t samples() const {
+    size_t result = 0;
+    for (auto const total : totals) {
+      result += total;
+    }
+
+    return result;
+  }
+
+  // samples lost because the ring was full, collect more often when this grows
+  [[nodiscard]] MAAN_INLINE size_t dropped() const {
+    return dropped_count.load(std::memory_order_relaxed);
+  }
+
+  // forgets the collected profile, pending samples stay in the ring
+  MAAN_INLINE void reset() {
+    totals = {};
+    stacks.clear();
+    dropped_count.store(0, std::memory_order_relaxed);
+  }
+};
+} // namespace maan
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <maan/stack.hpp>
+#include <maan/table.hpp>
+
+namespace maan {
+// owns a slot in the registry instead of a stack location, so references can be stored and destroyed in any order.
+// freed slots are reused through the free list luaL_ref keeps in the registry
+class reference {
+protected:
+  lua_State* state = nullptr;
+  int ref = LUA_NOREF;
+
+public:
+  reference() = default;
+
+  MAAN_INLINE reference(lua_State* state, int const index) : state{state} {
+    operations::copy(state, index);
+    ref = luaL_ref(state, LUA_REGISTRYINDEX);
+  }
+
+  MAAN_INLINE ~reference() {
+    reset();
+  }
+
+  reference(reference const&) = delete;
+  reference& operator=(reference const&) = delete;
+
+  MAAN_INLINE reference(reference&& other) noexcept : state{other.state}, ref{std::exchange(other.ref, LUA_NOREF)} {}
+
+  MAAN_INLINE reference& operator=(reference&& other) noexcept {
+    if (this != &other) {
+      reset();
+      state = other.state;
+      ref = std::exchange(other.ref, LUA_NOREF);
+    }
+
+    return *this;
+  }
+
+  MAAN_INLINE void reset() {
+    if (state != nullptr && ref != LUA_NOREF) {
+      luaL_unref(state, LUA_REGISTRYINDEX, ref);
+    }
+
+    ref = LUA_NOREF;
+  }
+
+  [[nodiscard]] MAAN_INLINE bool valid() const {
+    return state != nullptr && ref != LUA_NOREF && ref != LUA_REFNIL;
+  }
+
+  MAAN_INLINE void push() const {
+    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
+  }
+
+  [[nodiscard]] MAAN_INLINE lua_State* get_state() const {
+    return state;
+  }
+
+  [[nodiscard]] MAAN_INLINE int get_ref() const {
+    return ref;
+  }
+};
+
+class function_reference : public reference {
+public:
+  using reference::reference;
+
+  MAAN_INLINE function_reference(vm_function const& other) : reference(other.state, other.location) {}
+
+  template <int result_count = LUA_MULTRET, typename... types>
+  [[nodiscard]] MAAN_INLINE int call(types&&... args) const {
+    const auto error_function_pos = operations::push_error_handler(state);
+    push();
+    return stack::invoke<result_count>(state, error_function_pos, std::forward<types>(args)...);
+  }
+};
+
+class table_reference : public reference {
+public:
+  using reference::reference;
+
+  MAAN_INLINE table_reference(vm_table const& other) : reference(other.state, other.location) {}
+
+  // pushes the table, the returned table owns the new top slot
+  [[nodiscard]] MAAN_INLINE table get() const {
+    push();
+    return {state, -1};
+  }
+
+  template <typename T>
+  MAAN_INLINE void set(auto&& field, T&& value) const {
+    get().set(std::forward<decltype(field)>(field), std::forward<T>(value));
+  }
+
+  template <typename T>
+  [[nodiscard]] MAAN_INLINE bool map(auto&& field, auto&& fn) const {
+    const auto top = operations::size(state);
+    const auto result = get().template map<T>(std::forward<decltype(field)>(field), std::forward<decltype(fn)>(fn));
+    lua_settop(state, top);
+    return result;
+  }
+};
+} // namespace maan
@@ -4,6 +4,7 @@
 #include <maan/operations.hpp>
 #include <maan/vm_types.hpp>
 #include <maan/aggregate.hpp>
+#include <maan/interned.hpp>
 
 namespace maan::stack {
 template <typename T>
@@ -21,7 +22,9 @@ template <typename T>
 MAAN_INLINE void push(lua_State* state, T&& value) {
   using type = std::remove_cvref_t<T>;
 
-  if constexpr (aggregate::is_lua_convertable<type>) {
+  if constexpr (keys::is_key<type>) {
+    return value.push(state);
+  } else if constexpr (aggregate::is_lua_convertable<type>) {
     return aggregate::push(state, std::forward<T>(value));
   } else {
     return vm_types::push(state, std::forward<T>(value));
@@ -39,34 +42,68 @@ template <typename T>
   }
 }
 
+namespace detail {
+template <typename T>
+consteval int slot_count() {
+  using type = std::remove_cvref_t<T>;
+  static_assert(!std::is_function_v<std::remove_pointer_t<type>>, "c++ function types and lambdas cannot be pushed onto the stack directly");
+  static_assert(vm_types::is_lua_convertable<type> || aggregate::is_lua_convertable<type> || keys::is_key<type>, "unknown argument type");
+
+  // keys are aggregates too, but always take a single slot
+  if constexpr (aggregate::is_lua_convertable<type> && !keys::is_key<type>) {
+    return aggregate::stack_size<type>();
+  } else {
+    return 1;
+  }
+}
+} // namespace detail
+
+// the number of stack slots pushing values of the given types takes
+template <typename... Ts>
+consteval int slot_count() {
+  return (0 + ... + detail::slot_count<Ts>());
+}
+
+// calls the function below the arguments, error_function_pos is the position of the error handler or 0
 template <int result_count = LUA_MULTRET, typename... Ts>
-[[nodiscard]] MAAN_INLINE int call(lua_State* state, Ts&&... args) {
-  constexpr auto stack_slot_count = []<size_t index = 0, size_t result = 0>(this auto&& self) {
-    using tuple_type = std::tuple<Ts...>;
-
-    if constexpr (index == sizeof...(Ts)) {
-      return result;
-    } else {
-      using arg_type = std::remove_cvref_t<std::tuple_element_t<index, tuple_type>>;
-      static_assert(!std::is_function_v<std::remove_pointer_t<arg_type>>, "c++ function types and lambdas cannot be pushed onto the stack directly");
-      static_assert(vm_types::is_lua_convertable<arg_type> || aggregate::is_lua_convertable<arg_type>, "unknown argument type");
-
-      if constexpr (aggregate::is_lua_convertable<arg_type>) {
-        return self.template operator()<index + 1, result + aggregate::stack_size<arg_type>()>();
-      } else {
-        return self.template operator()<index + 1, result + 1>();
-      }
+[[nodiscard]] MAAN_INLINE int invoke(lua_State* state, int const error_function_pos, Ts&&... args) {
+  static constexpr auto stack_slot_count = slot_count<Ts...>();
+
+  // LuaJIT grows the stack on every push, only calls with more than LUA_MINSTACK slots reserve up front to fail cleanly
+  if constexpr (stack_slot_count > LUA_MINSTACK) {
+    if (!operations::reserve(state, stack_slot_count)) [[unlikely]] {
+      // drop the function and error handler that the caller pushed
+      operations::pop(state, error_function_pos != 0 ? 2 : 1);
+      return -5;
     }
-  }();
+  }
 
   if constexpr (constexpr int param_count = sizeof...(Ts); param_count != 0) {
     (push(state, std::forward<Ts>(args)), ...);
   }
 
-  if constexpr (result_count == LUA_MULTRET) {
-    return operations::pcall(state, stack_slot_count);
-  } else {
-    return operations::pcall(state, stack_slot_count, result_count);
+  return operations::pcall(state, stack_slot_count, result_count, error_function_pos);
+}
+
+// calls the function on top of the stack
+template <int result_count = LUA_MULTRET, typename... Ts>
+[[nodiscard]] MAAN_INLINE int call(lua_State* state, Ts&&... args) {
+  // the handler is pushed before any argument, so moving it below the function swaps two slots instead of shifting the arguments
+  const auto function_pos = operations::size(state);
+  const auto error_function_pos = operations::push_error_handler(state);
+  if (error_function_pos != 0) {
+    operations::insert(state, function_pos);
   }
+
+  return invoke<result_count>(state, error_function_pos != 0 ? function_pos : 0, std::forward<Ts>(args)...);
+}
+
+// calls the function at index and leaves it in place, the handler is pushed before a copy of the function like function::call does
+template <int result_count = LUA_MULTRET, typename... Ts>
+[[nodiscard]] MAAN_INLINE int call_at(lua_State* state, int const index, Ts&&... args) {
+  const auto function_pos = operations::abs(state, index);
+  const auto error_function_pos = operations::push_error_handler(state);
+  operations::copy(state, function_pos);
+  return invoke<result_count>(state, error_function_pos, std::forward<Ts>(args)...);
 }
 } // namespace maan::stack
\ No newline at end of file
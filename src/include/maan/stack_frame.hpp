@@ -0,0 +1,56 @@
+#pragma once
+
+#include <maan/stack.hpp>
+
+namespace maan {
+// restores the stack top it was created with in a single lua_settop, instead of removing owned slots one by one
+class stack_frame {
+  lua_State* state;
+  int top;
+  bool reserved = true;
+
+public:
+  MAAN_INLINE explicit stack_frame(lua_State* state) : state{state}, top{operations::size(state)} {}
+
+  // the reservation is done with a single lua_checkstack, see is_reserved
+  MAAN_INLINE stack_frame(lua_State* state, int const reserve) : stack_frame(state) {
+    reserved = operations::reserve(state, reserve);
+  }
+
+  MAAN_INLINE ~stack_frame() {
+    if (state != nullptr) {
+      lua_settop(state, top);
+    }
+  }
+
+  stack_frame(stack_frame const&) = delete;
+  stack_frame& operator=(stack_frame const&) = delete;
+
+  MAAN_INLINE stack_frame(stack_frame&& other) noexcept : state{std::exchange(other.state, nullptr)}, top{other.top}, reserved{other.reserved} {}
+  stack_frame& operator=(stack_frame&&) = delete;
+
+  // reserves the slots needed to push values of the given types, plus extra
+  template <typename... Ts>
+  [[nodiscard]] MAAN_INLINE static stack_frame reserve_for(lua_State* state, int const extra = 0) {
+    return {state, stack::slot_count<Ts...>() + extra};
+  }
+
+  [[nodiscard]] MAAN_INLINE bool is_reserved() const {
+    return reserved;
+  }
+
+  [[nodiscard]] MAAN_INLINE int base() const {
+    return top;
+  }
+
+  // the number of values pushed since the frame was created
+  [[nodiscard]] MAAN_INLINE int size() const {
+    return operations::size(state) - top;
+  }
+
+  // leaves everything pushed within the frame on the stack
+  MAAN_INLINE void release() {
+    state = nullptr;
+  }
+};
+} // namespace maan
@@ -29,6 +29,14 @@ public:
     has_ownership = true;
   }
 
+  // preallocates array_size array slots and record_size hash slots
+  MAAN_INLINE table(lua_State* state, int const array_size, int const record_size) {
+    lua_createtable(state, array_size, record_size);
+    const auto position = operations::abs(state, -1);
+    view = {state, position};
+    has_ownership = true;
+  }
+
   MAAN_INLINE ~table() {
     if (view.location > 0 && has_ownership) {
       operations::remove(view.state, view.location);
@@ -113,5 +121,25 @@ public:
       lua_rawset(view.state, view.location);
     }
   }
+
+  // like set with a function, but the function is bound at compile time, see native_function::push<function>
+  template <auto function, native_function::argument_check check = native_function::argument_check::checked>
+    requires native_function::is_function<decltype(function)>
+  MAAN_INLINE void set(auto&& field) const {
+    using field_type = std::remove_cvref_t<decltype(field)>;
+    static constexpr auto field_is_index = std::is_integral_v<field_type>;
+
+    if constexpr (!field_is_index) {
+      stack::push(view.state, std::forward<decltype(field)>(field));
+    }
+
+    native_function::push<function, check>(view.state);
+
+    if constexpr (field_is_index) {
+      lua_rawseti(view.state, view.location, std::forward<decltype(field)>(field));
+    } else {
+      lua_rawset(view.state, view.location);
+    }
+  }
 };
 } // namespace maan
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <maan/stack.hpp>
+#include <maan/native_function.hpp>
+
+namespace maan::usertypes::detail {
+// property accessors get the object out of the userdata header, so the dispatch functions don't depend on the type
+using getter = int (*)(lua_State*, void*);
+using setter = void (*)(lua_State*, void*);
+
+MAAN_INLINE inline void* object(lua_State* state, int const index) {
+  return static_cast<vm_types::detail::lua_userdata*>(lua_touserdata(state, index))->data;
+}
+
+inline int index(lua_State* state) {
+  // expected stack layout:
+  // - key
+  // - object
+
+  lua_pushvalue(state, 2);
+  lua_rawget(state, lua_upvalueindex(1));
+
+  if (operations::is(state, -1, vm_type_tag::lightuserdata)) {
+    return reinterpret_cast<getter>(lua_touserdata(state, -1))(state, object(state, 1));
+  }
+
+  lua_pushvalue(state, 2);
+  lua_rawget(state, lua_upvalueindex(2));
+  return 1;
+}
+
+inline int new_index(lua_State* state) {
+  // expected stack layout:
+  // - value
+  // - key
+  // - object
+
+  lua_pushvalue(state, 2);
+  lua_rawget(state, lua_upvalueindex(1));
+
+  if (!operations::is(state, -1, vm_type_tag::lightuserdata)) [[unlikely]] {
+    luaL_error(state, "cannot assign to field '%s'", lua_tolstring(state, 2, nullptr));
+    utilities::assume_unreachable();
+  }
+
+  reinterpret_cast<setter>(lua_touserdata(state, -1))(state, object(state, 1));
+  return 0;
+}
+} // namespace maan::usertypes::detail
+
+namespace maan {
+// adds methods and properties to the metatable of a vm_types::by_value type, which every vm creates once and caches in its registry.
+// member functions bind with the object as their first argument, so scripts call them as value:method(...)
+template <typename T>
+class usertype {
+  static_assert(vm_types::by_value<T>, "usertypes have to opt in through vm_types::by_value");
+
+  lua_State* state;
+  int metatable;
+
+  MAAN_INLINE void set(int const table_index, const char* name, auto&& fn) const {
+    native_function::push(state, std::forward<decltype(fn)>(fn));
+    lua_setfield(state, table_index, name);
+  }
+
+  template <auto member>
+  static int get_property(lua_State* state, void* object) {
+    auto* self = static_cast<T*>(object);
+
+    if constexpr (std::is_member_object_pointer_v<decltype(member)>) {
+      static_assert(stack::slot_count<decltype(self->*member)>() == 1, "properties have to fit into a single stack slot");
+      stack::push(state, self->*member);
+    } else {
+      static_assert(stack::slot_count<decltype((self->*member)())>() == 1, "properties have to fit into a single stack slot");
+      stack::push(state, (self->*member)());
+    }
+
+    return 1;
+  }
+
+  template <auto member>
+  static void set_property(lua_State* state, void* object) {
+    auto* self = static_cast<T*>(object);
+
+    using value_type = decltype([] {
+      if constexpr (std::is_member_object_pointer_v<decltype(member)>) {
+        return std::type_identity<std::remove_cvref_t<decltype(std::declval<T&>().*member)>>{};
+      } else {
+        return std::type_identity<std::remove_cvref_t<typename native_function::info<decltype(member)>::template argument_types<1>>>{};
+      }
+    }())::type;
+
+    if (!stack::is<value_type>(state, 3)) [[unlikely]] {
+      luaL_error(state, "invalid value for field '%s' { got: %s }", lua_tolstring(state, 2, nullptr), luaL_typename(state, 3));
+      utilities::assume_unreachable();
+    }
+
+    if constexpr (std::is_member_object_pointer_v<decltype(member)>) {
+      self->*member = stack::get<value_type>(state, 3);
+    } else {
+      (self->*member)(stack::get<value_type>(state, 3));
+    }
+  }
+
+  // fetches the accessor table stored under field, creating it and the metamethod that dispatches through it if needed
+  MAAN_INLINE void push_accessors(const char* field, const char* metamethod, lua_CFunction const dispatch, bool const with_methods) const {
+    lua_getfield(state, metatable, field);
+    if (operations::is(state, -1, vm_type_tag::table)) {
+      return;
+    }
+
+    operations::pop(state, 1);
+    lua_createtable(state, 0, 4);
+    lua_pushvalue(state, -1);
+    lua_setfield(state, metatable, field);
+
+    lua_pushvalue(state, -1);
+    if (with_methods) {
+      lua_getfield(state, metatable, "__methods");
+    }
+
+    lua_pushcclosure(state, dispatch, with_methods ? 2 : 1);
+    lua_setfield(state, metatable, metamethod);
+  }
+
+  MAAN_INLINE void add_accessor(const char* field, const char* metamethod, lua_CFunction const dispatch, bool const with_methods, const char* name,
+                                void* accessor) const {
+    push_accessors(field, metamethod, dispatch, with_methods);
+    lua_pushlightuserdata(state, accessor);
+    lua_setfield(state, -2, name);
+    operations::pop(state, 1);
+  }
+
+public:
+  MAAN_INLINE explicit usertype(lua_State* state) : state{state} {
+    vm_types::detail::push_metatable<T>(state);
+    metatable = operations::size(state);
+  }
+
+  MAAN_INLINE ~usertype() {
+    operations::remove(state, metatable);
+  }
+
+  usertype(usertype const&) = delete;
+  usertype& operator=(usertype const&) = delete;
+  usertype(usertype&&) = delete;
+  usertype& operator=(usertype&&) = delete;
+
+  MAAN_INLINE usertype& method(const char* name, auto&& fn) {
+    lua_getfield(state, metatable, "__methods");
+    set(operations::size(state), name, std::forward<decltype(fn)>(fn));
+    operations::pop(state, 1);
+    return *this;
+  }
+
+  // metamethods like __tostring, __eq or __add, __gc, __index and __newindex are managed by the usertype
+  MAAN_INLINE usertype& meta_method(const char* name, auto&& fn) {
+    set(metatable, name, std::forward<decltype(fn)>(fn));
+    return *this;
+  }
+
+  // a data member (&T::x) or a getter and optional setter pair (&T::get_x, &T::set_x).
+  // types without properties keep __index as the plain method table, with properties __index becomes a single
+  // c function that checks the property table first and calls the accessor directly, methods cost one extra miss
+  template <auto getter, auto setter = nullptr>
+  MAAN_INLINE usertype& property(const char* name) {
+    static_assert(std::is_member_pointer_v<decltype(getter)>, "property getters have to be data members or member functions of T");
+
+    add_accessor("__getters", "__index", usertypes::detail::index, true, name,
+                 reinterpret_cast<void*>(static_cast<usertypes::detail::getter>(&get_property<getter>)));
+
+    if constexpr (std::is_member_object_pointer_v<decltype(getter)> && std::is_same_v<decltype(setter), std::nullptr_t>) {
+      add_accessor("__setters", "__newindex", usertypes::detail::new_index, false, name,
+                   reinterpret_cast<void*>(static_cast<usertypes::detail::setter>(&set_property<getter>)));
+    } else if constexpr (!std::is_same_v<decltype(setter), std::nullptr_t>) {
+      add_accessor("__setters", "__newindex", usertypes::detail::new_index, false, name,
+                   reinterpret_cast<void*>(static_cast<usertypes::detail::setter>(&set_property<setter>)));
+    }
+
+    return *this;
+  }
+
+  // like property, but data members can't be assigned from scripts either
+  template <auto getter>
+  MAAN_INLINE usertype& readonly_property(const char* name) {
+    add_accessor("__getters", "__index", usertypes::detail::index, true, name,
+                 reinterpret_cast<void*>(static_cast<usertypes::detail::getter>(&get_property<getter>)));
+    return *this;
+  }
+
+  // constructs a value in place on top of the stack
+  template <typename... Ts>
+  MAAN_INLINE static T* make(lua_State* state, Ts&&... args) {
+    return vm_types::detail::emplace<T>(state, std::forward<Ts>(args)...);
+  }
+
+  [[nodiscard]] MAAN_INLINE static bool is(lua_State* state, int const index) {
+    return vm_types::detail::has_metatable<T>(state, index);
+  }
+
+  [[nodiscard]] MAAN_INLINE static T& get(lua_State* state, int const index) {
+    return vm_types::get<T>(state, index);
+  }
+};
+} // namespace maan
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <string_view>
 #include <type_traits>
 
 // these definitions come largely from:
@@ -91,6 +93,22 @@
 #endif
 
 namespace maan::utilities {
+MAAN_INLINE constexpr uint32_t fnv1a32_hash(std::string_view const data, uint32_t hash = 0x811c9dc5) {
+  for (const auto c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x01000193;
+  }
+  return hash;
+}
+
+MAAN_INLINE constexpr uint64_t fnv1a64_hash(std::string_view const data, uint64_t hash = 0xcbf29ce484222325) {
+  for (const auto c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
 namespace detail {
 struct utype {
   template <typename T>
@@ -206,15 +224,6 @@ struct value_namer {
   }
 };
 
-static consteval uint32_t fnv1a32_hash(const char* sig) {
-  uint32_t tmp = 0x811c9dc5;
-  while (*sig) // NOLINT(readability-implicit-bool-conversion)
-  {
-    tmp ^= *sig++; // NOLINT(hicpp-signed-bitwise,cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    tmp *= 0x01000193;
-  }
-  return tmp;
-}
 } // namespace detail
 
 template <typename T>
@@ -223,7 +232,7 @@ struct type_tag {
 
   template <typename t = T>
   static consteval uint32_t hash() {
-    return std::integral_constant<uint32_t, detail::fnv1a32_hash(FUNCTION_NAME)>{};
+    return std::integral_constant<uint32_t, fnv1a32_hash(FUNCTION_NAME)>{};
   }
 
   template <auto C = 0>
@@ -248,7 +257,7 @@ struct const_tag {
 
   template <auto v = V>
   static consteval uint32_t hash() {
-    return std::integral_constant<uint32_t, detail::fnv1a32_hash(FUNCTION_NAME)>{};
+    return std::integral_constant<uint32_t, fnv1a32_hash(FUNCTION_NAME)>{};
   }
 
   template <auto C = 0>
@@ -290,6 +299,30 @@ public:
   }
 };
 
+// a string literal that can be used as a template argument
+template <size_t Size>
+struct fixed_string {
+  char value[Size]{};
+
+  consteval fixed_string(const char (&literal)[Size]) noexcept {
+    for (size_t i = 0; i < Size; ++i) {
+      value[i] = literal[i];
+    }
+  }
+
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    return Size - 1;
+  }
+
+  [[nodiscard]] constexpr const char* data() const noexcept {
+    return value;
+  }
+
+  constexpr operator std::string_view() const noexcept {
+    return {value, Size - 1};
+  }
+};
+
 template <typename T>
 concept aggregate_member_countable = std::is_aggregate_v<T>;
 
@@ -406,6 +439,64 @@ MAAN_INLINE constexpr decltype(auto) visit_members(member_countable auto&& objec
   }
 }
 
+namespace detail {
+template <typename T>
+struct reflection_wrapper {
+  T value;
+};
+
+// never defined, only the addresses of its members are used to name them
+template <typename T>
+extern const reflection_wrapper<T> reflection_object;
+
+template <auto pointer>
+consteval std::string_view pointer_signature() {
+  return FUNCTION_NAME;
+}
+
+struct reflection_probe {
+  int maan_reflection_probe;
+};
+
+template <typename T, size_t index>
+consteval auto member_pointer() {
+  return visit_members(reflection_object<T>.value, [](auto const&... members) { return &std::get<index>(std::tie(members...)); });
+}
+
+template <typename T, size_t index>
+consteval std::string_view member_name_view() {
+  // the probe tells how much of the signature follows the member name, which is the same for every member pointer
+  constexpr std::string_view probe_name = "maan_reflection_probe";
+  constexpr auto probe = pointer_signature<member_pointer<reflection_probe, 0>()>();
+  constexpr auto suffix_size = probe.size() - probe.rfind(probe_name) - probe_name.size();
+
+  constexpr auto signature = pointer_signature<member_pointer<T, index>()>();
+  constexpr auto end = signature.size() - suffix_size;
+  constexpr auto begin = signature.find_last_of(":.>", end - 1) + 1;
+  return signature.substr(begin, end - begin);
+}
+
+template <typename T, size_t index>
+struct member_namer {
+  static constexpr auto name = []() {
+    constexpr std::string_view view = member_name_view<T, index>();
+    std::array<char, view.length() + 1> data = {};
+    std::copy(view.begin(), view.end(), data.data());
+    return data;
+  }();
+
+  static constexpr std::string_view value{name.data(), name.size() - 1};
+};
+} // namespace detail
+
+// the names of an aggregate's members, taken from the signature of a function templated on a pointer to each member
+template <member_countable T>
+consteval auto member_names() {
+  return []<size_t... i>(std::index_sequence<i...>) {
+    return std::array<std::string_view, sizeof...(i)>{detail::member_namer<T, i>::value...};
+  }(std::make_index_sequence<member_count<T>()>{});
+}
+
 MAAN_INLINE constexpr auto to_underlying(auto&& enum_value) {
   using type = std::remove_cvref_t<decltype(enum_value)>;
   return static_cast<std::underlying_type_t<type>>(enum_value);
@@ -4,10 +4,19 @@
 #include <maan/function.hpp>
 #include <maan/table.hpp>
 #include <maan/native_function.hpp>
+#include <maan/bytecode_cache.hpp>
+#include <maan/reference.hpp>
+#include <maan/stack_frame.hpp>
+#include <maan/allocator.hpp>
+#include <maan/libraries.hpp>
+#include <maan/coroutine.hpp>
+#include <maan/usertype.hpp>
+#include <maan/ffi.hpp>
 
 namespace maan {
 class vm {
   lua_State* state;
+  bytecode_cache* cache = nullptr;
 
 public:
   [[nodiscard]] MAAN_INLINE bool running() const {
@@ -18,6 +27,23 @@ public:
     return operations::working_set(state);
   }
 
+  [[nodiscard]] MAAN_INLINE size_t working_set_bytes() const {
+    return operations::working_set_bytes(state);
+  }
+
+  // runs incremental gc steps for at most roughly budget, see operations::perform_gc_for
+  MAAN_INLINE operations::gc_report collect_garbage_for(std::chrono::nanoseconds const budget, int const step_size = 0) const {
+    return operations::perform_gc_for(state, budget, step_size);
+  }
+
+  MAAN_INLINE int set_gc_pause(int const pause) const {
+    return operations::set_gc_pause(state, pause);
+  }
+
+  MAAN_INLINE int set_gc_step_multiplier(int const step_multiplier) const {
+    return operations::set_gc_step_multiplier(state, step_multiplier);
+  }
+
   [[nodiscard]] MAAN_INLINE lua_State* get_state() const {
     return state;
   }
@@ -30,36 +56,68 @@ public:
     operations::pop(state, n);
   }
 
-  [[nodiscard]] MAAN_INLINE int load(const char* name, std::string_view const code) const {
-    return operations::load(state, name, code.data(), code.size());
+  [[nodiscard]] MAAN_INLINE stack_frame frame(int const reserve = 0) const {
+    return {state, reserve};
   }
 
-  [[nodiscard]] MAAN_INLINE int load(const char* name, std::string_view const code, int const env_table_index) const {
-    return operations::load(state, name, code.data(), code.size(), env_table_index);
+  // a frame with room for a function and the given argument types
+  template <typename... Ts>
+  [[nodiscard]] MAAN_INLINE stack_frame frame_for() const {
+    return stack_frame::reserve_for<Ts...>(state, 1);
+  }
+
+  MAAN_INLINE void set_traceback_policy(operations::traceback_policy const policy) const {
+    operations::set_traceback_policy(state, policy);
+  }
+
+  [[nodiscard]] MAAN_INLINE std::string traceback() const {
+    return operations::traceback(state);
   }
 
   [[nodiscard]] MAAN_INLINE int load(const char* name, const char* code, size_t const size) const {
+    if (cache != nullptr) {
+      return cache->load(state, name, code, size);
+    }
+
     return operations::load(state, name, code, size);
   }
 
   [[nodiscard]] MAAN_INLINE int load(const char* name, const char* code, size_t const size, int const env_table_index) const {
-    return operations::load(state, name, code, size, env_table_index);
+    if (const auto result = load(name, code, size); result == LUA_OK) {
+      return operations::set_environment(state, env_table_index);
+    } else {
+      return result;
+    }
+  }
+
+  [[nodiscard]] MAAN_INLINE int load(const char* name, std::string_view const code) const {
+    return load(name, code.data(), code.size());
+  }
+
+  [[nodiscard]] MAAN_INLINE int load(const char* name, std::string_view const code, int const env_table_index) const {
+    return load(name, code.data(), code.size(), env_table_index);
   }
 
   [[nodiscard]] MAAN_INLINE int execute(const char* name, const char* code, size_t const size) const {
-    return operations::execute(state, name, code, size);
+    return operations::execute_loaded(state, [&] { return load(name, code, size); });
   }
 
   [[nodiscard]] MAAN_INLINE int execute(const char* name, const char* code, size_t const size, int const env_table_index) const {
-    return operations::execute(state, name, code, size, env_table_index);
+    const auto env_pos = operations::abs(state, env_table_index);
+    return operations::execute_loaded(state, [&] { return load(name, code, size, env_pos); });
   }
 
   [[nodiscard]] MAAN_INLINE int execute(const char* name, std::string_view const code) const {
-    return operations::execute(state, name, code.data(), code.size());
+    return execute(name, code.data(), code.size());
   }
 
   [[nodiscard]] MAAN_INLINE int execute(const char* name, std::string_view const code, int const env_table_index) const {
-    return operations::execute(state, name, code.data(), code.size(), env_table_index);
+    return execute(name, code.data(), code.size(), env_table_index);
+  }
+
+  // chunks loaded through this vm go through the cache until it is reset with nullptr, the cache has to outlive the vm
+  MAAN_INLINE bytecode_cache* set_bytecode_cache(bytecode_cache* new_cache) {
+    return std::exchange(cache, new_cache);
   }
 
   template <typename T>
@@ -68,6 +126,8 @@ public:
 
     if constexpr (std::is_same_v<type, function>) {
       return function(state, index);
+    } else if constexpr (std::is_same_v<type, function_reference> || std::is_same_v<type, table_reference> || std::is_same_v<type, coroutine>) {
+      return type(state, index);
     } else {
       return stack::get<T>(state, index);
     }
@@ -77,8 +137,10 @@ public:
   [[nodiscard]] MAAN_INLINE bool is(int const index) const {
     using type = std::remove_cvref_t<T>;
 
-    if constexpr (std::is_same_v<type, function>) {
+    if constexpr (std::is_same_v<type, function> || std::is_same_v<type, function_reference> || std::is_same_v<type, coroutine>) {
       return operations::is(state, index, vm_type_tag::function);
+    } else if constexpr (std::is_same_v<type, table_reference>) {
+      return operations::is(state, index, vm_type_tag::table);
     } else {
       return stack::is<T>(state, index);
     }
@@ -90,7 +152,9 @@ public:
 
   template <typename T>
   MAAN_INLINE void push(T&& value) const {
-    if constexpr (native_function::is_function<T>) {
+    if constexpr (std::is_base_of_v<reference, std::remove_cvref_t<T>>) {
+      return value.push();
+    } else if constexpr (native_function::is_function<T>) {
       return native_function::push(state, std::forward<T>(value));
     } else if constexpr (native_function::is_cfunction<T>) {
       return native_function::push(state, std::forward<T>(value));
@@ -99,6 +163,26 @@ public:
     }
   }
 
+  // pushes a function that validates its arguments according to check, see native_function::argument_check
+  template <native_function::argument_check check, typename T>
+    requires native_function::is_function<T>
+  MAAN_INLINE void push(T&& value) const {
+    native_function::push<check>(state, std::forward<T>(value));
+  }
+
+  // pushes a function bound at compile time, see native_function::push<function>
+  template <auto function, native_function::argument_check check = native_function::argument_check::checked>
+    requires native_function::is_function<decltype(function)>
+  MAAN_INLINE void push() const {
+    native_function::push<function, check>(state);
+  }
+
+  // pushes a single function that dispatches to the matching overload, see native_function::push_overloads
+  template <typename... Ts>
+  MAAN_INLINE void push_overloads(Ts&&... functions) const {
+    native_function::push_overloads(state, std::forward<Ts>(functions)...);
+  }
+
   template <int result_count = LUA_MULTRET, typename... Ts>
   [[nodiscard]] MAAN_INLINE int call(Ts&&... args) const {
     constexpr auto stack_slot_count = []<size_t index = 0, size_t result = 0>(this auto&& self) {
@@ -121,6 +205,27 @@ public:
     return stack::call<result_count>(state, std::forward<Ts>(args)...);
   }
 
+  // calls the function at index without consuming it, see stack::call_at
+  template <int result_count = LUA_MULTRET, typename... Ts>
+  [[nodiscard]] MAAN_INLINE int call_at(int const index, Ts&&... args) const {
+    return stack::call_at<result_count>(state, index, std::forward<Ts>(args)...);
+  }
+
+  // methods added through the returned usertype are shared by every value of T in this vm
+  template <typename T>
+  [[nodiscard]] MAAN_INLINE usertype<T> new_usertype() const {
+    return usertype<T>(state);
+  }
+
+  template <typename T>
+  MAAN_INLINE void register_pointers(T const* begin, size_t const count = 1) const {
+    pointer_registry::add(state, begin, count);
+  }
+
+  MAAN_INLINE bool unregister_pointers(void const* begin) const {
+    return pointer_registry::remove(state, begin);
+  }
+
   [[nodiscard]] MAAN_INLINE table get_globals() const {
     lua_pushvalue(state, LUA_GLOBALSINDEX);
     return {state, -1};
@@ -140,6 +245,29 @@ public:
     }
   }
 
+  // the allocator has to outlive the vm, lua_newstate fails on LuaJIT x64 builds without LJ_GC64
+  template <allocator::is_allocator allocator_type>
+  MAAN_INLINE explicit vm(allocator_type& allocator) : state{lua_newstate(allocator::function<allocator_type>, &allocator)} {
+    if (state != nullptr) {
+      luaL_openlibs(state);
+    }
+  }
+
+  template <library eager, library lazy>
+  MAAN_INLINE explicit vm(library_set<eager, lazy> const libraries) : state{luaL_newstate()} {
+    if (state != nullptr) {
+      libraries::open(state, libraries);
+    }
+  }
+
+  template <allocator::is_allocator allocator_type, library eager, library lazy>
+  MAAN_INLINE vm(allocator_type& allocator, library_set<eager, lazy> const libraries)
+      : state{lua_newstate(allocator::function<allocator_type>, &allocator)} {
+    if (state != nullptr) {
+      libraries::open(state, libraries);
+    }
+  }
+
   MAAN_INLINE explicit vm(lua_State* state) : state{state} {}
 
   MAAN_INLINE ~vm() {
@@ -150,11 +278,12 @@ public:
     lua_close(state);
   }
 
-  MAAN_INLINE vm(vm&& other) noexcept : state{std::exchange(other.state, nullptr)} {};
+  MAAN_INLINE vm(vm&& other) noexcept : state{std::exchange(other.state, nullptr)}, cache{std::exchange(other.cache, nullptr)} {};
 
   MAAN_INLINE vm& operator=(vm&& other) noexcept {
     if (this != &other) {
       state = std::exchange(other.state, nullptr);
+      cache = std::exchange(other.cache, nullptr);
     }
 
     return *this;
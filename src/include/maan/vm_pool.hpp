@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include <maan/vm.hpp>
+
+namespace maan {
+// a fixed set of vms prepared once by an init callback and handed out to threads.
+// checkout claims a slot with a single atomic exchange, preferring the slot the calling thread used last,
+// and only blocks when every vm is checked out
+class vm_pool {
+  using clock = std::chrono::steady_clock;
+
+  struct alignas(64) slot {
+    vm instance{nullptr};
+    std::atomic<bool> in_use{false};
+  };
+
+  struct affinity {
+    const vm_pool* pool;
+    size_t index;
+  };
+
+  static inline thread_local affinity last_slot{};
+
+  std::unique_ptr<slot[]> slots;
+  size_t count;
+
+  int gc_step_size;
+
+  std::atomic<size_t> available;
+  std::atomic<size_t> checkout_count{};
+  std::atomic<size_t> wait_count{};
+  std::atomic<int64_t> total_wait{};
+  std::atomic<int64_t> maximum_wait{};
+  std::atomic<size_t> peak_in_use{};
+
+  [[nodiscard]] size_t preferred_slot() const {
+    if (last_slot.pool == this) {
+      return last_slot.index;
+    }
+
+    return std::hash<std::thread::id>{}(std::this_thread::get_id()) % count;
+  }
+
+  static void update_maximum(auto& value, auto const candidate) {
+    auto current = value.load(std::memory_order_relaxed);
+    while (current < candidate && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+    }
+  }
+
+  void release(size_t const index) {
+    auto& entry = slots[index];
+
+    // returned vms start out with an empty stack
+    operations::clear(entry.instance.get_state());
+    if (gc_step_size >= 0) {
+      operations::perform_gc_step(entry.instance.get_state(), gc_step_size);
+    }
+
+    last_slot = {this, index};
+
+    // counting the vm as available before freeing its slot keeps the counter from dropping below zero when another thread
+    // claims the slot right away, a waiter that wakes up in between just retries
+    available.fetch_add(1, std::memory_order_release);
+    entry.in_use.store(false, std::memory_order_release);
+    available.notify_one();
+  }
+
+public:
+  class handle {
+    vm_pool* pool;
+    size_t index;
+
+  public:
+    MAAN_INLINE handle(vm_pool* pool, size_t const index) : pool{pool}, index{index} {}
+
+    MAAN_INLINE ~handle() {
+      if (pool != nullptr) {
+        pool->release(index);
+      }
+    }
+
+    handle(handle const&) = delete;
+    handle& operator=(handle const&) = delete;
+
+    MAAN_INLINE handle(handle&& other) noexcept : pool{std::exchange(other.pool, nullptr)}, index{other.index} {}
+
+    MAAN_INLINE handle& operator=(handle&& other) noexcept {
+      if (this != &other) {
+        if (pool != nullptr) {
+          pool->release(index);
+        }
+
+        pool = std::exchange(other.pool, nullptr);
+        index = other.index;
+      }
+
+      return *this;
+    }
+
+    [[nodiscard]] MAAN_INLINE vm& get() const {
+      return pool->slots[index].instance;
+    }
+
+    [[nodiscard]] MAAN_INLINE vm& operator*() const {
+      return get();
+    }
+
+    [[nodiscard]] MAAN_INLINE vm* operator->() const {
+      return &get();
+    }
+
+    [[nodiscard]] MAAN_INLINE size_t slot() const {
+      return index;
+    }
+  };
+
+  struct metrics {
+    size_t capacity;
+    size_t in_use;
+    size_t peak_in_use;
+    size_t checkouts;
+    size_t waits;
+    std::chrono::nanoseconds total_wait;
+    std::chrono::nanoseconds maximum_wait;
+
+    [[nodiscard]] double utilisation() const {
+      return capacity == 0 ? 0. : static_cast<double>(in_use) / static_cast<double>(capacity);
+    }
+  };
+
+  // create returns a new vm, init prepares it (libraries, bindings, scripts)
+  // gc_step_size >= 0 performs a gc step of that size whenever a vm is returned
+  vm_pool(size_t const size, auto&& create, auto&& init, int const gc_step_size = -1)
+    requires std::is_invocable_r_v<vm, decltype(create)> && std::is_invocable_v<decltype(init), vm&>
+      : slots{std::make_unique<slot[]>(size)}, count{size}, gc_step_size{gc_step_size}, available{size} {
+    for (size_t i = 0; i < count; ++i) {
+      slots[i].instance = create();
+      init(slots[i].instance);
+      operations::clear(slots[i].instance.get_state());
+    }
+  }
+
+  vm_pool(size_t const size, auto&& init, int const gc_step_size = -1)
+    requires std::is_invocable_v<decltype(init), vm&>
+      : vm_pool(size, [] { return vm(); }, std::forward<decltype(init)>(init), gc_step_size) {}
+
+  vm_pool(vm_pool const&) = delete;
+  vm_pool& operator=(vm_pool const&) = delete;
+  vm_pool(vm_pool&&) = delete;
+  vm_pool& operator=(vm_pool&&) = delete;
+
+  [[nodiscard]] std::optional<handle> try_checkout() {
+    const auto start = preferred_slot();
+
+    for (size_t i = 0; i < count; ++i) {
+      const auto index = (start + i) % count;
+      auto& entry = slots[index];
+
+      if (entry.in_use.load(std::memory_order_relaxed) || entry.in_use.exchange(true, std::memory_order_acquire)) {
+        continue;
+      }
+
+      const auto remaining = available.fetch_sub(1, std::memory_order_acq_rel) - 1;
+      update_maximum(peak_in_use, count - remaining);
+      checkout_count.fetch_add(1, std::memory_order_relaxed);
+
+      return std::optional<handle>{std::in_place, this, index};
+    }
+
+    return std::nullopt;
+  }
+
+  // blocks until a vm is returned if all of them are checked out
+  [[nodiscard]] handle checkout() {
+    if (auto result = try_checkout(); result.has_value()) [[likely]] {
+      return std::move(*result);
+    }
+
+    const auto start = clock::now();
+
+    while (true) {
+      if (available.load(std::memory_order_acquire) == 0) {
+        available.wait(0, std::memory_order_acquire);
+      }
+
+      if (auto result = try_checkout(); result.has_value()) {
+        const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+
+        wait_count.fetch_add(1, std::memory_order_relaxed);
+        total_wait.fetch_add(waited, std::memory_order_relaxed);
+        update_maximum(maximum_wait, waited);
+
+        return std::move(*result);
+      }
+    }
+  }
+
+  [[nodiscard]] metrics get_metrics() const {
+    return {
+      .capacity = count,
+      .in_use = count - available.load(std::memory_order_relaxed),
+      .peak_in_use = peak_in_use.load(std::memory_order_relaxed),
+      .checkouts = checkout_count.load(std::memory_order_relaxed),
+      .waits = wait_count.load(std::memory_order_relaxed),
+      .total_wait = std::chrono::nanoseconds{total_wait.load(std::memory_order_relaxed)},
+      .maximum_wait = std::chrono::nanoseconds{maximum_wait.load(std::memory_order_relaxed)},
+    };
+  }
+
+  [[nodiscard]] size_t size() const {
+    return count;
+  }
+};
+} // namespace maan
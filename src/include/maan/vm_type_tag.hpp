@@ -12,5 +12,7 @@ enum class vm_type_tag : int {
   function = 6,
   userdata = 7,
   thread = 8,
+  // luajit only, lua.h doesn't name it
+  cdata = 10,
 };
 }
\ No newline at end of file
@@ -4,8 +4,62 @@
 #include <maan/vm_function.hpp>
 #include <maan/operations.hpp>
 #include <maan/utilities.hpp>
+#include <maan/pointer_registry.hpp>
+
+#include <array>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace maan {
+// a pointer that is passed to lua as ffi cdata pointing to a struct declared from T's members, see maan/ffi.hpp.
+// scripts read and write the pointee in place, which compiled traces can do without leaving the jit
+template <typename T>
+class cdata {
+  T* pointer = nullptr;
+
+public:
+  using element_type = T;
+
+  cdata() = default;
+
+  MAAN_INLINE cdata(T* pointer) : pointer{pointer} {} // NOLINT(hicpp-explicit-conversions)
+
+  [[nodiscard]] MAAN_INLINE T* get() const {
+    return pointer;
+  }
+
+  [[nodiscard]] MAAN_INLINE T& operator*() const {
+    return *pointer;
+  }
+
+  [[nodiscard]] MAAN_INLINE T* operator->() const {
+    return pointer;
+  }
+};
+} // namespace maan
+
+// defined in maan/ffi.hpp, which includes this header through aggregate.hpp and is included at the end of it
+namespace maan::ffi {
+template <typename T>
+bool push(lua_State* state, T* pointer);
+
+template <typename T>
+bool is(lua_State* state, int index);
+} // namespace maan::ffi
 
 namespace maan::vm_types {
+// opt-in per pointee type, pointers are pushed as light userdata instead of a full userdata allocation
+// their type is checked against the ranges registered through maan::pointer_registry
+template <typename T>
+inline constexpr bool light_userdata = false;
+
+// opt-in per type, values are moved into a userdata that carries the type's metatable, see maan::usertype
+template <typename T>
+inline constexpr bool by_value = false;
+
 namespace detail {
 struct lua_userdata {
   uintptr_t hash;
@@ -30,17 +84,169 @@ concept is_lua_convertable_table = std::is_same_v<T, vm_table>;
 template <typename T>
 concept is_lua_convertable_function = std::is_same_v<T, vm_function>;
 
+// contiguous ranges map to the array part of a table and associative containers to the hash part
+template <typename T>
+struct container_traits {
+  static constexpr bool is_sequence = false;
+  static constexpr bool is_associative = false;
+};
+
+template <typename T, typename allocator_type>
+struct container_traits<std::vector<T, allocator_type>> {
+  using value_type = T;
+  static constexpr bool is_sequence = true;
+  static constexpr bool is_associative = false;
+};
+
+template <typename T, size_t size>
+struct container_traits<std::array<T, size>> {
+  using value_type = T;
+  static constexpr bool is_sequence = true;
+  static constexpr bool is_associative = false;
+};
+
+// spans can only be pushed, there is nothing for them to point to on the way back
+template <typename T, size_t extent>
+struct container_traits<std::span<T, extent>> {
+  using value_type = std::remove_cv_t<T>;
+  static constexpr bool is_sequence = true;
+  static constexpr bool is_associative = false;
+};
+
+template <typename K, typename T, typename hash_type, typename equal_type, typename allocator_type>
+struct container_traits<std::unordered_map<K, T, hash_type, equal_type, allocator_type>> {
+  using key_type = K;
+  using value_type = T;
+  static constexpr bool is_sequence = false;
+  static constexpr bool is_associative = true;
+};
+
+template <typename T>
+concept is_lua_convertable_container = container_traits<T>::is_sequence || container_traits<T>::is_associative;
+
+template <typename T>
+inline constexpr bool is_span = false;
+
+template <typename T, size_t extent>
+inline constexpr bool is_span<std::span<T, extent>> = true;
+
+template <typename T>
+inline constexpr bool is_array = false;
+
+template <typename T, size_t size>
+inline constexpr bool is_array<std::array<T, size>> = true;
+
 template <typename T>
 concept is_lua_fundamental_convertable = std::is_same_v<bool, T> || is_lua_convertable_integer<T> || is_lua_convertable_number<T> ||
                                          is_lua_convertable_string<T> || is_lua_convertable_table<T> || is_lua_convertable_function<T>;
 
 template <typename T>
 concept is_lua_convertable_pointer = std::is_pointer_v<T> && std::is_class_v<std::remove_pointer<T>>;
+
+template <typename T>
+using pointee_type = std::remove_cv_t<std::remove_pointer_t<T>>;
+
+template <typename T>
+concept is_lua_convertable_light_pointer = is_lua_convertable_pointer<T> && light_userdata<pointee_type<T>>;
+
+template <typename T>
+concept is_lua_convertable_value = std::is_class_v<T> && by_value<T>;
+
+template <typename T>
+inline constexpr bool is_cdata = false;
+
+template <typename T>
+inline constexpr bool is_cdata<cdata<T>> = true;
+
+template <typename T>
+concept is_lua_convertable_cdata = is_cdata<T>;
+
+// the registry key of T's metatable, every type has its own address so keys can't collide like type hashes can
+template <typename T>
+inline char metatable_anchor{};
+
+template <typename T>
+MAAN_INLINE void* metatable_key() {
+  return &metatable_anchor<T>;
+}
+
+// pushes the metatable shared by every value of T, it's created the first time a vm needs it
+template <typename T>
+MAAN_INLINE void push_metatable(lua_State* state) {
+  lua_pushlightuserdata(state, metatable_key<T>());
+  lua_rawget(state, LUA_REGISTRYINDEX);
+
+  if (operations::is(state, -1, vm_type_tag::table)) [[likely]] {
+    return;
+  }
+
+  operations::pop(state, 1);
+  lua_createtable(state, 0, 3);
+
+  // methods live in a plain table so looking them up is a single raw hash hit,
+  // __methods keeps it reachable once properties replace __index with a function
+  lua_createtable(state, 0, 0);
+  lua_pushvalue(state, -1);
+  lua_setfield(state, -3, "__methods");
+  lua_setfield(state, -2, "__index");
+
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    lua_pushcclosure(
+      state,
+      +[](lua_State* state) -> int {
+        const auto* data = static_cast<lua_userdata*>(lua_touserdata(state, 1));
+        static_cast<T*>(data->data)->~T();
+        return 0;
+      },
+      0);
+    lua_setfield(state, -2, "__gc");
+  }
+
+  lua_pushlightuserdata(state, metatable_key<T>());
+  lua_pushvalue(state, -2);
+  lua_rawset(state, LUA_REGISTRYINDEX);
+}
+
+template <typename T>
+MAAN_INLINE bool has_metatable(lua_State* state, int const index) {
+  if (lua_getmetatable(state, index) == 0) {
+    return false;
+  }
+
+  lua_pushlightuserdata(state, metatable_key<T>());
+  lua_rawget(state, LUA_REGISTRYINDEX);
+
+  const auto result = lua_rawequal(state, -1, -2) != 0;
+  operations::pop(state, 2);
+  return result;
+}
+
+// constructs T inside a new userdata, behind the same header pointers use so T* conversions work on it too
+template <typename T, typename... Ts>
+MAAN_INLINE T* emplace(lua_State* state, Ts&&... args) {
+  // lua only aligns userdata like a double
+  static constexpr auto padding = alignof(T) > alignof(double) ? alignof(T) - alignof(double) : 0;
+  static constexpr auto size = sizeof(lua_userdata) + sizeof(T) + padding;
+
+  auto* block = static_cast<std::byte*>(lua_newuserdata(state, size));
+
+  void* storage = block + sizeof(lua_userdata);
+  auto space = sizeof(T) + padding;
+  std::align(alignof(T), sizeof(T), storage, space);
+
+  auto* object = new (storage) T(std::forward<Ts>(args)...);
+  new (block) lua_userdata(static_cast<std::uintptr_t>(utilities::type_tag<T*>::hash()), object);
+
+  push_metatable<T>(state);
+  lua_setmetatable(state, -2);
+  return object;
+}
 } // namespace detail
 
 template <typename T>
 concept is_lua_convertable = !std::is_function_v<std::remove_pointer_t<T>> &&
-                             (std::is_void_v<T> || detail::is_lua_fundamental_convertable<T> || detail::is_lua_convertable_pointer<T>);
+                             (std::is_void_v<T> || detail::is_lua_fundamental_convertable<T> || detail::is_lua_convertable_pointer<T> ||
+                              detail::is_lua_convertable_container<T> || detail::is_lua_convertable_value<T> || detail::is_lua_convertable_cdata<T>);
 
 MAAN_INLINE void push(lua_State* state, auto&& object)
   requires is_lua_convertable<std::remove_cvref_t<decltype(object)>>
@@ -71,9 +277,40 @@ MAAN_INLINE void push(lua_State* state, auto&& object)
       static_assert(std::is_same_v<void, type>, "unsupported fundamental type to vm_types::push");
       utilities::assume_unreachable();
     }
+  } else if constexpr (detail::is_lua_convertable_light_pointer<type>) {
+    lua_pushlightuserdata(state, const_cast<detail::pointee_type<type>*>(object));
   } else if constexpr (detail::is_lua_convertable_pointer<type>) {
     const auto type_hash = static_cast<std::uintptr_t>(utilities::type_tag<type>::hash());
     new (lua_newuserdata(state, sizeof(type_hash) + sizeof(void*))) detail::lua_userdata(type_hash, reinterpret_cast<void*>(object));
+  } else if constexpr (detail::is_lua_convertable_value<type>) {
+    detail::emplace<type>(state, std::forward<decltype(object)>(object));
+  } else if constexpr (detail::is_lua_convertable_cdata<type>) {
+    // pushes nil if the struct can't be declared
+    (void)ffi::push(state, object.get());
+  } else if constexpr (detail::is_lua_convertable_container<type>) {
+    using traits = detail::container_traits<type>;
+    static_assert(is_lua_convertable<typename traits::value_type>, "container has an unsupported value type");
+
+    if constexpr (traits::is_sequence) {
+      // the table is created with its final size, so it never has to rehash while it's filled
+      lua_createtable(state, static_cast<int>(std::size(object)), 0);
+
+      int lua_index = 0;
+      for (const auto& element : std::as_const(object)) {
+        push(state, static_cast<typename traits::value_type const&>(element));
+        lua_rawseti(state, -2, ++lua_index);
+      }
+    } else {
+      static_assert(is_lua_convertable<typename traits::key_type>, "container has an unsupported key type");
+
+      lua_createtable(state, 0, static_cast<int>(object.size()));
+
+      for (const auto& [key, value] : object) {
+        push(state, key);
+        push(state, value);
+        lua_rawset(state, -3);
+      }
+    }
   } else {
     static_assert(std::is_same_v<void, type>, "unsupported type to vm_types::push");
     utilities::assume_unreachable();
@@ -112,8 +349,57 @@ MAAN_INLINE decltype(auto) get(lua_State* state, int const index)
       utilities::assume_unreachable();
     }
   } else if constexpr (detail::is_lua_convertable_pointer<type>) {
+    if (operations::is(state, index, vm_type_tag::lightuserdata)) {
+      return static_cast<type>(lua_touserdata(state, index));
+    }
+
     const auto* data = static_cast<detail::lua_userdata*>(lua_touserdata(state, index));
     return reinterpret_cast<type>(data->data);
+  } else if constexpr (detail::is_lua_convertable_value<type>) {
+    // refers to the object inside the userdata, it lives as long as lua keeps the userdata alive
+    const auto* data = static_cast<detail::lua_userdata*>(lua_touserdata(state, index));
+    return *static_cast<type*>(data->data);
+  } else if constexpr (detail::is_lua_convertable_cdata<type>) {
+    // the payload of a pointer cdata is the pointer itself
+    const auto* payload = lua_topointer(state, index);
+    return payload != nullptr ? type{*static_cast<typename type::element_type* const*>(payload)} : type{};
+  } else if constexpr (detail::is_lua_convertable_container<type>) {
+    using traits = detail::container_traits<type>;
+    static_assert(!detail::is_span<type>, "spans can only be pushed");
+
+    const auto table_index = operations::abs(state, index);
+
+    type result{};
+    if (!operations::is(state, table_index, vm_type_tag::table)) [[unlikely]] {
+      return result;
+    }
+
+    if constexpr (detail::is_array<type>) {
+      for (size_t i = 0; i < result.size(); ++i) {
+        lua_rawgeti(state, table_index, static_cast<int>(i + 1));
+        result[i] = get<typename traits::value_type>(state, -1);
+        operations::pop(state, 1);
+      }
+    } else if constexpr (traits::is_sequence) {
+      const auto size = static_cast<int>(lua_objlen(state, table_index));
+      result.reserve(size);
+
+      for (int i = 1; i <= size; ++i) {
+        lua_rawgeti(state, table_index, i);
+        result.push_back(get<typename traits::value_type>(state, -1));
+        operations::pop(state, 1);
+      }
+    } else {
+      lua_pushnil(state);
+      while (lua_next(state, table_index) != 0) {
+        // converting a copy keeps lua_tolstring from changing the key lua_next continues from
+        lua_pushvalue(state, -2);
+        result.emplace(get<typename traits::key_type>(state, -1), get<typename traits::value_type>(state, -2));
+        operations::pop(state, 2);
+      }
+    }
+
+    return result;
   } else {
     static_assert(std::is_same_v<void, type>, "unsupported type to vm_types::get");
     utilities::assume_unreachable();
@@ -145,8 +431,31 @@ MAAN_INLINE bool is(lua_State* state, int const index)
       utilities::assume_unreachable();
     }
   } else if constexpr (detail::is_lua_convertable_pointer<type>) {
-    const auto* data = static_cast<detail::lua_userdata*>(lua_touserdata(state, index));
-    return data->hash == static_cast<std::uintptr_t>(utilities::type_tag<type>::hash());
+    switch (operations::type(state, index)) {
+    case vm_type_tag::lightuserdata: {
+      return pointer_registry::is<detail::pointee_type<type>>(state, lua_touserdata(state, index));
+    }
+    case vm_type_tag::userdata: {
+      const auto* data = static_cast<detail::lua_userdata*>(lua_touserdata(state, index));
+      return data->hash == static_cast<std::uintptr_t>(utilities::type_tag<type>::hash());
+    }
+    default: {
+      return false;
+    }
+    }
+  } else if constexpr (detail::is_lua_convertable_value<type>) {
+    return detail::has_metatable<type>(state, index);
+  } else if constexpr (detail::is_lua_convertable_cdata<type>) {
+    return ffi::is<typename type::element_type>(state, index);
+  } else if constexpr (detail::is_lua_convertable_container<type>) {
+    static_assert(!detail::is_span<type>, "spans can only be pushed");
+
+    // only the table itself is checked, not every element
+    if constexpr (detail::is_array<type>) {
+      return operations::is(state, index, vm_type_tag::table) && lua_objlen(state, index) == std::tuple_size_v<type>;
+    } else {
+      return operations::is(state, index, vm_type_tag::table);
+    }
   } else {
     static_assert(std::is_same_v<void, type>, "unsupported type to vm_types::is");
     utilities::assume_unreachable();
@@ -180,9 +489,17 @@ MAAN_INLINE std::string_view name([[maybe_unused]] lua_State* state, [[maybe_unu
     }
   } else if constexpr (detail::is_lua_convertable_pointer<type>) {
     return utilities::type_tag<type>::to_string();
+  } else if constexpr (detail::is_lua_convertable_value<type>) {
+    return utilities::type_tag<type>::to_string();
+  } else if constexpr (detail::is_lua_convertable_cdata<type>) {
+    return "cdata";
+  } else if constexpr (detail::is_lua_convertable_container<type>) {
+    return "table";
   } else {
     static_assert(std::is_same_v<void, type>, "unsupported type to vm_types::name");
     utilities::assume_unreachable();
   }
 }
-} // namespace maan::vm_types
\ No newline at end of file
+} // namespace maan::vm_types
+
+#include <maan/ffi.hpp>
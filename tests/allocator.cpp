@@ -0,0 +1,61 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("pool allocator", "[allocator]") {
+  auto pool = maan::allocator::pool();
+
+  {
+    auto vm = maan::vm(pool);
+    REQUIRE(vm.running() == true);
+
+    const auto& stats = pool.get_statistics();
+    REQUIRE(stats.live_bytes > 0);
+    REQUIRE(stats.allocation_count > 0);
+
+    const auto live_bytes = stats.live_bytes;
+
+    REQUIRE(vm.execute("code", "local t = {} for i = 1, 1000 do t[i] = tostring(i) end return #t") == 1);
+    REQUIRE(vm.get<int>(-1) == 1000);
+    vm.pop();
+
+    REQUIRE(stats.peak_bytes > live_bytes);
+    REQUIRE(stats.peak_bytes >= stats.live_bytes);
+  }
+
+  REQUIRE(pool.get_statistics().live_bytes == 0);
+}
+
+TEST_CASE("pool allocator quota", "[allocator]") {
+  auto pool = maan::allocator::pool(4 * 1024 * 1024);
+
+  auto vm = maan::vm(pool);
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return string.rep('x', 16 * 1024 * 1024)") == -2);
+  REQUIRE(pool.get_statistics().failed_count > 0);
+  REQUIRE(pool.get_statistics().live_bytes <= pool.get_quota());
+}
+
+TEST_CASE("pool allocator moves blocks between backings", "[allocator]") {
+  auto pool = maan::allocator::pool();
+
+  // a malloc backed block that shrinks into a size class is copied into the pool
+  auto* large = static_cast<char*>(pool(nullptr, 0, 1024));
+  REQUIRE(large != nullptr);
+  std::memset(large, 'a', 1024);
+
+  auto* small = static_cast<char*>(pool(large, 1024, 32));
+  REQUIRE(small != nullptr);
+  REQUIRE(small[0] == 'a');
+  REQUIRE(small[31] == 'a');
+
+  // and grows back out of it
+  auto* grown = static_cast<char*>(pool(small, 32, 2048));
+  REQUIRE(grown != nullptr);
+  REQUIRE(grown[31] == 'a');
+
+  (void)pool(grown, 2048, 0);
+  REQUIRE(pool.get_statistics().live_bytes == 0);
+  REQUIRE(pool.get_statistics().failed_count == 0);
+}
@@ -0,0 +1,44 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+int checked_sum(int a, int b) {
+  return a + b;
+}
+} // namespace
+
+TEST_CASE("argument check policies", "[functions]") {
+  using maan::native_function::argument_check;
+
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push<argument_check::checked>(+[](int a, int b) -> int { return a + b; });
+  lua_setglobal(vm.get_state(), "checked");
+  vm.push<argument_check::unchecked>(+[](int a, int b) -> int { return a + b; });
+  lua_setglobal(vm.get_state(), "unchecked");
+  vm.push<argument_check::debug>([](int a, int b) -> int { return a + b; });
+  lua_setglobal(vm.get_state(), "debug_checked");
+  vm.push<&checked_sum, argument_check::unchecked>();
+  lua_setglobal(vm.get_state(), "bound");
+  REQUIRE(vm.stack_size() == 0);
+
+  REQUIRE(vm.execute("code", "return checked(1, 2), unchecked(3, 4), debug_checked(5, 6), bound(7, 8)") == 4);
+  REQUIRE(vm.get<int>(-4) == 3);
+  REQUIRE(vm.get<int>(-3) == 7);
+  REQUIRE(vm.get<int>(-2) == 11);
+  REQUIRE(vm.get<int>(-1) == 15);
+  vm.pop(4);
+
+  REQUIRE(vm.execute("code", "return checked(1, 'two')") == -1);
+  vm.pop();
+
+  // nothing is validated, the string converts like lua_tointeger would
+  REQUIRE(vm.execute("code", "return unchecked(1, '2')") == 1);
+  REQUIRE(vm.get<int>(-1) == 3);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return debug_checked(1)") == (maan::native_function::is_checked(argument_check::debug) ? -1 : 1));
+  vm.pop();
+}
@@ -0,0 +1,35 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("batch calls", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return function(value) if value == 3 then error('three') end return value * 2 end") == 1);
+
+  {
+    const auto fn = vm.get<maan::function>(-1);
+
+    const auto inputs = std::vector<int>{1, 2, 3, 4, 5};
+    auto outputs = std::vector<double>(inputs.size(), -1.);
+
+    const auto errors = fn.call_batch(std::span{inputs}, std::span{outputs});
+    REQUIRE(vm.stack_size() == 1);
+
+    REQUIRE(errors.size() == 1);
+    REQUIRE(errors.front().index == 2);
+    REQUIRE(errors.front().code == -1);
+    REQUIRE(errors.front().message.find("three") != std::string::npos);
+
+    REQUIRE(outputs == std::vector<double>{2., 4., -1., 8., 10.});
+
+    // only as many calls as the shorter span holds
+    auto short_outputs = std::array<double, 2>{};
+    REQUIRE(fn.call_batch(std::span{inputs}, std::span{short_outputs}).empty());
+    REQUIRE(short_outputs[1] == 4.);
+    REQUIRE(vm.stack_size() == 1);
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+}
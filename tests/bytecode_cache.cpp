@@ -0,0 +1,122 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+const auto cached_code = R"(
+return function(a)
+    return a * 2
+end
+)";
+
+TEST_CASE("bytecode cache", "[code]") {
+  auto cache = maan::bytecode_cache();
+
+  for (auto i = 0; i < 3; ++i) {
+    auto vm = maan::vm();
+    REQUIRE(vm.running() == true);
+
+    vm.set_bytecode_cache(&cache);
+
+    REQUIRE(vm.execute("cached code", cached_code) == 1);
+    REQUIRE(vm.call(21) == 1);
+    REQUIRE(vm.get<int>(-1) == 42);
+
+    vm.pop();
+    REQUIRE(vm.stack_size() == 0);
+  }
+
+  REQUIRE(cache.misses() == 1);
+  REQUIRE(cache.hits() == 2);
+  REQUIRE(cache.size() == 1);
+
+  // the chunk name is part of the key
+  {
+    auto vm = maan::vm();
+    vm.set_bytecode_cache(&cache);
+
+    REQUIRE(vm.load("other name", cached_code) == LUA_OK);
+    REQUIRE(cache.misses() == 2);
+  }
+}
+
+TEST_CASE("bytecode cache on disk", "[code]") {
+  const auto directory = std::filesystem::temp_directory_path() / "maan_bytecode_cache_test";
+  std::filesystem::remove_all(directory);
+
+  {
+    auto cache = maan::bytecode_cache(directory);
+    auto vm = maan::vm();
+    vm.set_bytecode_cache(&cache);
+
+    REQUIRE(vm.execute("cached code", cached_code) == 1);
+    REQUIRE(cache.misses() == 1);
+  }
+
+  {
+    auto cache = maan::bytecode_cache(directory);
+    auto vm = maan::vm();
+    vm.set_bytecode_cache(&cache);
+
+    REQUIRE(vm.execute("cached code", cached_code) == 1);
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 0);
+
+    REQUIRE(vm.call(5) == 1);
+    REQUIRE(vm.get<int>(-1) == 10);
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("bytecode cache syntax error", "[code]") {
+  auto cache = maan::bytecode_cache();
+  auto vm = maan::vm();
+  vm.set_bytecode_cache(&cache);
+
+  REQUIRE(vm.execute("code", "return -;") == -1);
+  REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("bytecode cache corrupt entry", "[code]") {
+  const auto directory = std::filesystem::temp_directory_path() / "maan_bytecode_cache_corrupt_test";
+  std::filesystem::remove_all(directory);
+
+  {
+    auto cache = maan::bytecode_cache(directory);
+    auto vm = maan::vm();
+    vm.set_bytecode_cache(&cache);
+
+    REQUIRE(vm.execute("cached code", cached_code) == 1);
+  }
+
+  // no temporary files are left behind
+  auto chunk_count = 0;
+  for (auto const& entry : std::filesystem::directory_iterator(directory)) {
+    REQUIRE(entry.path().extension() == ".ljbc");
+
+    std::ofstream file{entry.path(), std::ios::binary | std::ios::trunc};
+    file << "\x1bLJ not bytecode";
+    ++chunk_count;
+  }
+  REQUIRE(chunk_count == 1);
+
+  {
+    auto cache = maan::bytecode_cache(directory);
+    auto vm = maan::vm();
+    vm.set_bytecode_cache(&cache);
+
+    REQUIRE(vm.execute("cached code", cached_code) == 1);
+    REQUIRE(cache.hits() == 0);
+    REQUIRE(cache.misses() == 1);
+
+    REQUIRE(vm.call(4) == 1);
+    REQUIRE(vm.get<int>(-1) == 8);
+    vm.pop();
+
+    // the rebuilt entry replaced the corrupt one
+    REQUIRE(vm.execute("cached code", cached_code) == 1);
+    REQUIRE(cache.hits() == 1);
+  }
+
+  std::filesystem::remove_all(directory);
+}
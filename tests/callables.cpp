@@ -0,0 +1,80 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+struct tracked_state {
+  static inline int destroyed = 0;
+
+  std::string prefix;
+
+  explicit tracked_state(std::string prefix) : prefix{std::move(prefix)} {}
+  tracked_state(tracked_state const&) = default;
+  tracked_state(tracked_state&&) = default;
+
+  ~tracked_state() {
+    ++destroyed;
+  }
+};
+
+struct alignas(32) aligned_accumulator {
+  double total = 0.;
+
+  double operator()(double value) {
+    total += value;
+    return total;
+  }
+};
+} // namespace
+
+TEST_CASE("capturing lambdas", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto calls = 0;
+  vm.push([&calls, offset = 10](int value) -> int {
+    ++calls;
+    return value + offset;
+  });
+  REQUIRE(vm.stack_size() == 1);
+
+  lua_setglobal(vm.get_state(), "add_offset");
+  REQUIRE(vm.execute("code", "return add_offset(1) + add_offset(2)") == 1);
+  REQUIRE(vm.get<int>(-1) == 23);
+  REQUIRE(calls == 2);
+  vm.pop();
+
+  vm.push([](int a, int b) -> int { return a * b; });
+  REQUIRE(lua_getupvalue(vm.get_state(), -1, 1) == nullptr);
+  REQUIRE(vm.call(6, 7) == 1);
+  REQUIRE(vm.get<int>(-1) == 42);
+  vm.pop();
+}
+
+TEST_CASE("stateful functors", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  const auto destroyed = tracked_state::destroyed;
+
+  {
+    vm.push([state = tracked_state{"hello "}](std::string_view name) -> std::string { return state.prefix + std::string{name}; });
+    lua_setglobal(vm.get_state(), "greet");
+  }
+
+  REQUIRE(vm.execute("code", "return greet('lua')") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "hello lua");
+  vm.pop();
+
+  const auto alive = tracked_state::destroyed;
+  REQUIRE(vm.execute("code", "greet = nil") == 0);
+  lua_gc(vm.get_state(), LUA_GCCOLLECT, 0);
+  REQUIRE(tracked_state::destroyed == alive + 1);
+  REQUIRE(tracked_state::destroyed > destroyed);
+
+  vm.push(aligned_accumulator{});
+  lua_setglobal(vm.get_state(), "accumulate");
+  REQUIRE(vm.execute("code", "accumulate(1.5) return accumulate(2)") == 1);
+  REQUIRE(vm.get<double>(-1) == 3.5);
+  vm.pop();
+}
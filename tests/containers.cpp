@@ -0,0 +1,76 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("sequence containers", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(std::vector<int>{1, 2, 3, 4});
+  REQUIRE(vm.stack_size() == 1);
+  REQUIRE(vm.is<std::vector<int>>(-1) == true);
+  REQUIRE(lua_objlen(vm.get_state(), -1) == 4);
+
+  const auto values = vm.get<std::vector<int>>(-1);
+  REQUIRE(values == std::vector<int>{1, 2, 3, 4});
+
+  REQUIRE(vm.is<std::array<int, 4>>(-1) == true);
+  REQUIRE(vm.is<std::array<int, 3>>(-1) == false);
+  REQUIRE(vm.get<std::array<int, 4>>(-1) == std::array<int, 4>{1, 2, 3, 4});
+  vm.pop();
+
+  const std::array<std::string, 2> names = {"a", "b"};
+  vm.push(std::span{names});
+  REQUIRE(vm.get<std::vector<std::string>>(-1) == std::vector<std::string>{"a", "b"});
+  vm.pop();
+
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("associative containers", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(std::unordered_map<std::string, int>{{"a", 1}, {"b", 2}});
+  REQUIRE(vm.is<std::unordered_map<std::string, int>>(-1) == true);
+
+  const auto values = vm.get<std::unordered_map<std::string, int>>(-1);
+  REQUIRE(values.size() == 2);
+  REQUIRE(values.at("a") == 1);
+  REQUIRE(values.at("b") == 2);
+  vm.pop();
+
+  // number keys stay numbers while the table is traversed
+  REQUIRE(vm.execute("code", "return { [1] = 'x', [2] = 'y', [10] = 'z' }") == 1);
+  const auto numbered = vm.get<std::unordered_map<std::string, std::string>>(-1);
+  REQUIRE(numbered.size() == 3);
+  REQUIRE(numbered.at("10") == "z");
+  vm.pop();
+
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("containers in functions", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(+[](std::vector<float> values) -> std::vector<float> {
+    for (auto& value : values) {
+      value *= 2.f;
+    }
+    return values;
+  });
+
+  REQUIRE(vm.call(std::vector<float>{1.f, 2.f}) == 1);
+  REQUIRE(vm.get<std::vector<float>>(-1) == std::vector<float>{2.f, 4.f});
+  vm.pop();
+
+  {
+    auto object = maan::table(vm.get_state(), 0, 2);
+    object.set("list", std::vector<int>{1, 2});
+    REQUIRE(object.map<std::vector<int>>("list", [](std::vector<int> const& list) { return list.size() == 2; }) == true);
+    vm.pop();
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("coroutine resume", "[coroutines]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  static constexpr std::string_view code = R"(
+    return function(a, b)
+      local c = coroutine.yield(a + b)
+      local d = coroutine.yield(c * 2)
+      return d .. "!"
+    end
+  )";
+
+  REQUIRE(vm.execute("code", code) == 1);
+  REQUIRE(vm.is<maan::coroutine>(-1) == true);
+
+  auto routine = vm.get<maan::coroutine>(-1);
+  vm.pop();
+  REQUIRE(vm.stack_size() == 0);
+  REQUIRE(routine.get_status() == maan::coroutine::status::ready);
+
+  REQUIRE(routine.resume(1, 2) == 1);
+  REQUIRE(routine.get_status() == maan::coroutine::status::suspended);
+  REQUIRE(routine.get<int>(1) == 3);
+
+  REQUIRE(routine.resume(21) == 1);
+  REQUIRE(routine.get<int>(1) == 42);
+
+  REQUIRE(routine.resume("done") == 1);
+  REQUIRE(routine.get_status() == maan::coroutine::status::finished);
+  REQUIRE(routine.get<std::string>(1) == "done!");
+
+  REQUIRE(routine.resume() == -1);
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("coroutine errors", "[coroutines]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return function() coroutine.yield(1) error('failed') end") == 1);
+
+  auto routine = maan::coroutine(vm.get_state(), -1);
+  vm.pop();
+
+  REQUIRE(routine.resume() == 1);
+  REQUIRE(routine.resume() == -1);
+  REQUIRE(routine.get_status() == maan::coroutine::status::failed);
+  REQUIRE(routine.error().find("failed") != std::string_view::npos);
+
+  // failed threads are replaced
+  auto* const thread = routine.get_thread();
+  routine.reset();
+  REQUIRE(routine.get_thread() != thread);
+  REQUIRE(routine.resume() == 1);
+  REQUIRE(routine.get<int>(1) == 1);
+}
+
+TEST_CASE("coroutine generators", "[coroutines]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return function() for i = 1, 5 do coroutine.yield(i) end return 100 end") == 1);
+
+  auto routine = vm.get<maan::coroutine>(-1);
+  vm.pop();
+
+  int sum = 0;
+  for (const auto value : routine.range<int>()) {
+    sum += value;
+  }
+
+  REQUIRE(sum == 15);
+  REQUIRE(routine.get_status() == maan::coroutine::status::finished);
+
+  // finished threads are reused
+  auto* const thread = routine.get_thread();
+
+  int count = 0;
+  for ([[maybe_unused]] const auto value : routine.range<int>()) {
+    ++count;
+  }
+
+  REQUIRE(count == 5);
+  REQUIRE(routine.get_thread() == thread);
+  REQUIRE(vm.stack_size() == 0);
+}
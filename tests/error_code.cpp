@@ -35,3 +35,46 @@ TEST_CASE("error code", "[code]") {
   REQUIRE(vm.is<const char*>(-1) == true);
   INFO(vm.get<const char*>(-1));
 }
+
+const auto nested_error_code = R"(
+local function fail() error("failure") end
+return fail();
+)";
+
+TEST_CASE("traceback policies", "[code]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  {
+    REQUIRE(vm.execute("code", nested_error_code) == -1);
+    REQUIRE(vm.stack_size() == 1);
+    REQUIRE(vm.get<std::string>(-1).find("stack traceback") != std::string::npos);
+    vm.pop();
+  }
+
+  {
+    vm.set_traceback_policy(maan::operations::traceback_policy::lazy);
+
+    REQUIRE(vm.execute("code", nested_error_code) == -1);
+    REQUIRE(vm.stack_size() == 1);
+    REQUIRE(vm.get<std::string>(-1).find("stack traceback") == std::string::npos);
+    vm.pop();
+
+    const auto traceback = vm.traceback();
+    REQUIRE(traceback.starts_with("stack traceback:"));
+    REQUIRE(traceback.find("code") != std::string::npos);
+  }
+
+  {
+    vm.set_traceback_policy(maan::operations::traceback_policy::none);
+
+    REQUIRE(vm.execute("code", nested_error_code) == -1);
+    REQUIRE(vm.stack_size() == 1);
+    REQUIRE(vm.get<std::string>(-1).find("stack traceback") == std::string::npos);
+    vm.pop();
+
+    REQUIRE(vm.traceback().empty());
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+}
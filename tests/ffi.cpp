@@ -0,0 +1,124 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct ffi_vector {
+  float x;
+  float y;
+  float z;
+};
+
+struct ffi_body {
+  ffi_vector position;
+  ffi_vector velocity;
+  int32_t id;
+  std::array<double, 2> extra;
+};
+
+TEST_CASE("ffi declarations", "[ffi]") {
+  const auto declaration = maan::ffi::declaration<ffi_vector>();
+  REQUIRE(declaration == "typedef struct { float x; float y; float z; } " + std::string{maan::ffi::name<ffi_vector>()} + ";");
+
+  const auto nested = maan::ffi::declaration<ffi_body>();
+  REQUIRE(nested.find(std::string{maan::ffi::name<ffi_vector>()} + " position;") != std::string::npos);
+  REQUIRE(nested.find("int32_t id;") != std::string::npos);
+  REQUIRE(nested.find("double extra[2];") != std::string::npos);
+
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(maan::ffi::declare<ffi_body>(vm.get_state()) == true);
+  REQUIRE(maan::ffi::declare<ffi_body>(vm.get_state()) == true);
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("ffi pointers", "[ffi]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto body = ffi_body{{1.f, 2.f, 3.f}, {0.f, 4.f, 0.f}, 7, {0.5, 1.5}};
+
+  vm.push(maan::cdata{&body});
+  REQUIRE(vm.stack_size() == 1);
+  REQUIRE(vm.is<maan::cdata<ffi_body>>(-1) == true);
+  REQUIRE(vm.is<maan::cdata<ffi_vector>>(-1) == false);
+  REQUIRE(vm.get<maan::cdata<ffi_body>>(-1).get() == &body);
+  lua_setglobal(vm.get_state(), "body");
+
+  REQUIRE(vm.execute("code", "body.position.x = body.position.x + body.velocity.y body.id = body.id + 1 body.extra[1] = 2 return body.extra[0]") == 1);
+  REQUIRE(vm.get<double>(-1) == 0.5);
+  vm.pop();
+
+  REQUIRE(body.position.x == 5.f);
+  REQUIRE(body.id == 8);
+  REQUIRE(body.extra[1] == 2.);
+
+  const auto* constant = &body;
+  REQUIRE(maan::ffi::push(vm.get_state(), constant) == true);
+  REQUIRE(maan::ffi::get<ffi_body const>(vm.get_state(), -1) == &body);
+  vm.pop();
+}
+
+TEST_CASE("ffi arrays", "[ffi]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto points = std::vector<ffi_vector>(64);
+
+  REQUIRE(maan::ffi::push(vm.get_state(), std::span{points}) == true);
+  lua_setglobal(vm.get_state(), "points");
+
+  REQUIRE(vm.execute("code", "for i = 0, 63 do points[i].x = i points[i].y = i * 2 end") == 0);
+
+  for (size_t i = 0; i < points.size(); ++i) {
+    REQUIRE(points[i].x == static_cast<float>(i));
+    REQUIRE(points[i].y == static_cast<float>(i * 2));
+  }
+
+  vm.push(+[](maan::cdata<ffi_vector> value) -> float { return value->x + value->y + value->z; });
+  lua_setglobal(vm.get_state(), "length");
+  REQUIRE(vm.execute("code", "return length(points + 3)") == 1);
+  REQUIRE(vm.get<float>(-1) == 9.f);
+  vm.pop();
+}
+
+namespace {
+double ffi_scale(double value, double factor) {
+  return value * factor;
+}
+
+void ffi_move(ffi_vector* value, float const offset) {
+  value->x += offset;
+  value->y += offset;
+}
+
+int32_t ffi_answer() {
+  return 42;
+}
+} // namespace
+
+TEST_CASE("ffi functions", "[ffi]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(maan::ffi::push_function(vm.get_state(), &ffi_scale) == true);
+  lua_setglobal(vm.get_state(), "scale");
+  REQUIRE(maan::ffi::push_function(vm.get_state(), &ffi_move) == true);
+  lua_setglobal(vm.get_state(), "move");
+  REQUIRE(maan::ffi::push_function(vm.get_state(), &ffi_answer) == true);
+  lua_setglobal(vm.get_state(), "answer");
+  REQUIRE(vm.stack_size() == 0);
+
+  auto point = ffi_vector{1.f, 2.f, 3.f};
+  vm.push(maan::cdata{&point});
+  lua_setglobal(vm.get_state(), "point");
+
+  REQUIRE(vm.execute("code", "local sum = 0 for i = 1, 1000 do sum = sum + scale(i, 2) end move(point, 1.5) return sum, answer()") == 2);
+  REQUIRE(vm.get<double>(-2) == 1001000.);
+  REQUIRE(vm.get<int>(-1) == 42);
+  vm.pop(2);
+
+  REQUIRE(point.x == 2.5f);
+  REQUIRE(point.y == 3.5f);
+  REQUIRE(point.z == 3.f);
+}
@@ -146,4 +146,35 @@ TEST_CASE("basic cfunctions", "[functions]") {
 
   REQUIRE(vm.is<float>(-1) == true);
   REQUIRE(vm.get<float>(-1) == 200.f);
-}
\ No newline at end of file
+}
+
+TEST_CASE("call functions in place", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return function(a, b) return a * b end") == 1);
+
+  REQUIRE(vm.call_at<1>(1, 6, 7) == 1);
+  REQUIRE(vm.stack_size() == 2);
+  REQUIRE(vm.get<int>(-1) == 42);
+  vm.pop();
+
+  REQUIRE(vm.call_at<1>(-1, 2, 3) == 1);
+  REQUIRE(vm.get<int>(-1) == 6);
+  vm.pop();
+
+  REQUIRE(vm.is<maan::vm_function>(1) == true);
+}
+
+TEST_CASE("execute with a relative environment", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  lua_newtable(vm.get_state());
+  vm.push(5);
+  lua_setfield(vm.get_state(), -2, "value");
+
+  REQUIRE(vm.execute("code", "return value", -1) == 1);
+  REQUIRE(vm.stack_size() == 2);
+  REQUIRE(vm.get<int>(-1) == 5);
+}
@@ -0,0 +1,35 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+const auto garbage_code = R"(
+for i = 1, 100000 do
+    local t = { i, tostring(i) }
+end
+)";
+
+TEST_CASE("budgeted garbage collection", "[gc]") {
+  using namespace std::chrono_literals;
+
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.set_gc_pause(1000);
+  REQUIRE(vm.set_gc_step_multiplier(200) > 0);
+
+  REQUIRE(vm.execute("garbage code", garbage_code) == 0);
+
+  const auto before = vm.working_set_bytes();
+  REQUIRE(before > 0);
+
+  const auto report = vm.collect_garbage_for(300us);
+  REQUIRE(report.steps > 0);
+  REQUIRE((report.cycle_finished || report.elapsed >= 300us));
+
+  auto cycles = 0;
+  while (!vm.collect_garbage_for(1ms).cycle_finished && cycles < 10000) {
+    ++cycles;
+  }
+
+  REQUIRE(vm.working_set_bytes() < before);
+}
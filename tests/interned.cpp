@@ -0,0 +1,53 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("interned keys", "[tables]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  {
+    auto object = maan::table(vm.get_state());
+    object.set(maan::interned<"health">{}, 100);
+
+    REQUIRE(object.map<int>(maan::interned<"health">{}, [](int value) { return value == 100; }) == true);
+    vm.pop();
+
+    REQUIRE(object.map<int>("health", [](int value) { return value == 100; }) == true);
+    vm.pop();
+
+    vm.push(maan::interned<"health">{});
+    REQUIRE(vm.get<std::string>(-1) == "health");
+    vm.pop();
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+  REQUIRE(maan::interned<"health">::value == "health");
+}
+
+TEST_CASE("key cache", "[tables]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  {
+    const auto keys = maan::key_cache(vm.get_state());
+    REQUIRE(vm.stack_size() == 1);
+
+    auto object = maan::table(vm.get_state());
+    object.set(keys.key<"x">(), 1.f);
+    object.set(keys.key<"y">(), 2.f);
+
+    REQUIRE(object.map<float>(keys.key<"x">(), [](float value) { return value == 1.f; }) == true);
+    vm.pop();
+
+    REQUIRE(object.map<float>("y", [](float value) { return value == 2.f; }) == true);
+    vm.pop();
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+
+  // functions take keys as arguments too
+  REQUIRE(vm.execute("code", "return function(key) return key .. '!' end") == 1);
+  REQUIRE(vm.call(maan::interned<"x">{}) == 1);
+  REQUIRE(vm.get<std::string>(-1) == "x!");
+}
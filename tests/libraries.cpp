@@ -0,0 +1,81 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+TEST_CASE("selective libraries", "[libraries]") {
+  using maan::library;
+
+  auto vm = maan::vm(maan::library_set<library::base | library::string | library::math>{});
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return io == nil and os == nil and debug == nil") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return string.upper('a') .. math.floor(1.5)") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "A1");
+  vm.pop();
+}
+
+TEST_CASE("lazy libraries", "[libraries]") {
+  using maan::library;
+
+  auto vm = maan::vm(maan::library_set<library::base, library::string | library::table>{});
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return rawget(_G, 'string') == nil and rawget(_G, 'table') == nil") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return string.rep('a', 3)") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "aaa");
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return rawget(_G, 'string') ~= nil and rawget(_G, 'table') == nil") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return table.concat({ 'a', 'b' }) .. tostring(io)") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "abnil");
+  vm.pop();
+
+  // the hook is removed once every lazy library is open
+  REQUIRE(vm.execute("code", "return getmetatable(_G) == nil") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+}
+
+TEST_CASE("the compiler runs without the jit library", "[libraries]") {
+  using maan::library;
+
+  auto vm = maan::vm(maan::library_set<library::base | library::string | library::math>{});
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "return jit == nil") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+
+  // the module stays registered for the host even though scripts can't see it
+  auto* state = vm.get_state();
+  lua_getfield(state, LUA_REGISTRYINDEX, "_LOADED");
+  lua_getfield(state, -1, LUA_JITLIBNAME);
+  lua_getfield(state, -1, "status");
+  REQUIRE(lua_pcall(state, 0, 1, 0) == 0);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop(3);
+}
+
+TEST_CASE("lazy string methods", "[libraries]") {
+  using maan::library;
+
+  auto vm = maan::vm(maan::library_set<library::base, library::string>{});
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "local s = 'x' return s:upper() .. ('%d'):format(5)") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "X5");
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return getmetatable('').__index == string") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct entity {
+  float x;
+  float y;
+};
+
+struct unrelated {
+  int value;
+};
+
+template <>
+inline constexpr bool maan::vm_types::light_userdata<entity> = true;
+
+TEST_CASE("light pointer type", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.stack_size() == 0);
+
+  entity entities[4] = {{1.f, 2.f}, {3.f, 4.f}, {5.f, 6.f}, {7.f, 8.f}};
+
+  vm.push(&entities[2]);
+  REQUIRE(vm.stack_size() == 1);
+  REQUIRE(lua_type(vm.get_state(), -1) == LUA_TLIGHTUSERDATA);
+
+  // unregistered addresses cannot be identified
+  REQUIRE(vm.is<entity*>(-1) == false);
+
+  vm.register_pointers(entities, std::size(entities));
+
+  REQUIRE(vm.is<entity*>(-1) == true);
+  REQUIRE(vm.is<unrelated*>(-1) == false);
+  REQUIRE(vm.get<entity*>(-1) == &entities[2]);
+
+  REQUIRE(vm.unregister_pointers(entities) == true);
+  REQUIRE(vm.is<entity*>(-1) == false);
+
+  vm.pop();
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("light pointer type in functions", "[types]") {
+  auto vm = maan::vm();
+
+  entity entities[2] = {{1.f, 2.f}, {3.f, 4.f}};
+  vm.register_pointers(entities, std::size(entities));
+
+  vm.push(+[](entity* e) { return e->x + e->y; });
+  REQUIRE(vm.call(&entities[1]) == 1);
+
+  REQUIRE(vm.get<float>(-1) == 7.f);
+  vm.pop();
+
+  // full userdata pointers keep working next to light ones
+  auto other = unrelated{10};
+  vm.push(&other);
+  REQUIRE(lua_type(vm.get_state(), -1) == LUA_TUSERDATA);
+  REQUIRE(vm.is<unrelated*>(-1) == true);
+  REQUIRE(vm.is<entity*>(-1) == false);
+  REQUIRE(vm.get<unrelated*>(-1)->value == 10);
+}
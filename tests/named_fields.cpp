@@ -0,0 +1,81 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct named_position {
+  float x;
+  float y;
+};
+
+struct named_entity {
+  int id;
+  std::string name;
+  named_position position;
+};
+
+struct renamed_entity {
+  int id;
+  bool alive;
+};
+
+template <>
+inline constexpr bool maan::aggregate::named_fields<named_position> = true;
+
+template <>
+inline constexpr bool maan::aggregate::named_fields<named_entity> = true;
+
+template <>
+inline constexpr bool maan::aggregate::named_fields<renamed_entity> = true;
+
+template <>
+inline constexpr auto maan::aggregate::field_names<renamed_entity> = std::array<std::string_view, 2>{"entity_id", "is_alive"};
+
+TEST_CASE("reflected field names", "[types]") {
+  static_assert(maan::utilities::member_names<named_entity>()[0] == "id");
+  static_assert(maan::utilities::member_names<named_entity>()[1] == "name");
+  static_assert(maan::utilities::member_names<named_entity>()[2] == "position");
+  static_assert(maan::aggregate::stack_size<named_entity>() == 1);
+}
+
+TEST_CASE("named field aggregates", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(named_entity{1, "player", {2.f, 3.f}});
+  REQUIRE(vm.stack_size() == 1);
+  REQUIRE(vm.is<named_entity>(-1) == true);
+
+  lua_setglobal(vm.get_state(), "entity");
+  REQUIRE(vm.execute("code", "return entity.name .. entity.id .. entity.position.x + entity.position.y") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "player15");
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return { position = { y = 4, x = 5 }, unknown = true, name = 'npc', id = 7 }") == 1);
+  const auto entity = vm.get<named_entity>(-1);
+  REQUIRE(entity.id == 7);
+  REQUIRE(entity.name == "npc");
+  REQUIRE(entity.position.x == 5.f);
+  REQUIRE(entity.position.y == 4.f);
+  vm.pop();
+
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("named field aggregates in functions", "[types]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(+[](named_position position) -> named_position { return {position.y, position.x}; });
+  lua_setglobal(vm.get_state(), "swap");
+
+  REQUIRE(vm.execute("code", "local p = swap({ x = 1, y = 2 }) return p.x * 10 + p.y") == 1);
+  REQUIRE(vm.get<int>(-1) == 21);
+  vm.pop();
+
+  vm.push(renamed_entity{3, true});
+  lua_setglobal(vm.get_state(), "renamed");
+
+  REQUIRE(vm.execute("code", "return renamed.entity_id == 3 and renamed.is_alive and renamed.id == nil") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+  vm.pop();
+}
@@ -0,0 +1,56 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct overload_entity {
+  float x;
+  float y;
+};
+
+TEST_CASE("overloads by stack size", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push_overloads(+[](float x, float y) -> float { return x + y; }, +[](overload_entity* entity) -> float { return entity->x * entity->y; });
+  lua_setglobal(vm.get_state(), "spawn");
+
+  auto entity = overload_entity{3.f, 4.f};
+  vm.push(&entity);
+  lua_setglobal(vm.get_state(), "entity");
+
+  REQUIRE(vm.execute("code", "return spawn(1, 2)") == 1);
+  REQUIRE(vm.get<float>(-1) == 3.f);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return spawn(entity)") == 1);
+  REQUIRE(vm.get<float>(-1) == 12.f);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return spawn()") == -1);
+  vm.pop();
+}
+
+TEST_CASE("overloads by argument type", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push_overloads(+[](int key, int value) -> int { return key + value; }, +[](std::string key, int value) -> std::string { return key + std::to_string(value); },
+                    +[](bool key, int value) -> int { return key ? value : -value; });
+  lua_setglobal(vm.get_state(), "describe");
+
+  REQUIRE(vm.execute("code", "return describe(1, 2)") == 1);
+  REQUIRE(vm.get<int>(-1) == 3);
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return describe('a', 2)") == 1);
+  REQUIRE(vm.get<std::string>(-1) == "a2");
+  vm.pop();
+
+  REQUIRE(vm.execute("code", "return describe(false, 2)") == 1);
+  REQUIRE(vm.get<int>(-1) == -2);
+  vm.pop();
+
+  // the last overload of a size reports the mismatch
+  REQUIRE(vm.execute("code", "return describe({}, 2)") == -1);
+  vm.pop();
+}
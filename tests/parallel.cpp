@@ -0,0 +1,71 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+#include <numeric>
+#include <vector>
+
+TEST_CASE("parallel map", "[parallel]") {
+  auto inputs = std::vector<int>(10000);
+  std::iota(inputs.begin(), inputs.end(), 0);
+
+  constexpr auto code = R"(
+    function square(value)
+      return value * value
+    end
+  )";
+
+  const auto result = maan::parallel_map<double>(code, "square", std::span<int const>{inputs}, {.worker_count = 4, .chunk_size = 64});
+  REQUIRE(result.ok() == true);
+  REQUIRE(result.values.size() == inputs.size());
+  REQUIRE(result.workers.size() == 4);
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    REQUIRE(result.values[i] == static_cast<double>(i * i));
+  }
+
+  size_t processed = 0;
+  for (const auto& worker : result.workers) {
+    processed += worker.items;
+  }
+
+  REQUIRE(processed == inputs.size());
+}
+
+TEST_CASE("parallel map errors", "[parallel]") {
+  auto inputs = std::vector<int>{1, 2, 3, 4};
+
+  constexpr auto code = R"(
+    function check(value)
+      if value == 3 then
+        error("three")
+      end
+      return value
+    end
+  )";
+
+  const auto result = maan::parallel_map<int>(code, "check", std::span<int const>{inputs}, {.worker_count = 2});
+  REQUIRE(result.ok() == false);
+  REQUIRE(result.errors.size() == 1);
+  REQUIRE(result.errors.front().index == 2);
+  REQUIRE(result.values[3] == 4);
+
+  const auto missing = maan::parallel_for("", "missing", std::span<int const>{inputs}, {.worker_count = 1});
+  REQUIRE(missing.ok() == false);
+  REQUIRE(missing.errors.front().index == maan::parallel::no_item);
+}
+
+TEST_CASE("parallel for with init", "[parallel]") {
+  auto inputs = std::vector<int>(100, 1);
+
+  auto options = maan::parallel::options{};
+  options.worker_count = 3;
+  options.init = [](maan::vm& vm) {
+    vm.push(+[](int value) { return value + 1; });
+    lua_setglobal(vm.get_state(), "increment");
+  };
+
+  const auto result = maan::parallel_for("function run(value) assert(increment(value) == 2) end", "run", std::span<int const>{inputs}, options);
+  REQUIRE(result.ok() == true);
+  REQUIRE(result.workers.size() == 3);
+}
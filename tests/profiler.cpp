@@ -0,0 +1,204 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+const auto hot_code = R"(
+local function step(i)
+  return i % 7
+end
+
+local sum = 0
+local start = os.clock()
+while os.clock() - start < 0.25 do
+  for i = 1, 100000 do
+    sum = sum + step(i)
+  end
+
+  for i = 1, 2000 do
+    local garbage = { i, tostring(i), { i } }
+  end
+end
+return sum
+)";
+
+// every line is "category;outer;...;inner count"
+bool is_folded(std::string_view folded) {
+  static constexpr std::array<std::string_view, 5> categories = {"interpreted", "compiled", "c", "gc", "compiler"};
+
+  while (!folded.empty()) {
+    const auto end = folded.find('\n');
+    if (end == std::string_view::npos) {
+      return false;
+    }
+
+    const auto line = folded.substr(0, end);
+    folded.remove_prefix(end + 1);
+
+    const auto space = line.rfind(' ');
+    if (space == std::string_view::npos || space + 1 == line.size()) {
+      return false;
+    }
+
+    const auto count = line.substr(space + 1);
+    if (!std::ranges::all_of(count, [](char const c) { return c >= '0' && c <= '9'; })) {
+      return false;
+    }
+
+    const auto stack = line.substr(0, space);
+    const auto category = stack.substr(0, stack.find(';'));
+    if (std::ranges::find(categories, category) == categories.end()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const auto busy_code = R"(
+local function step(i)
+  return i % 7
+end
+
+local sum = 0
+for i = 1, 2000000 do
+  sum = sum + step(i)
+end
+return sum
+)";
+} // namespace
+
+TEST_CASE("profiler starts and stops", "[profiler]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto profiler = maan::profiler(vm);
+  REQUIRE(profiler.running() == false);
+  REQUIRE(profiler.folded().empty());
+
+  REQUIRE(profiler.start() != maan::profiling::backend::none);
+  REQUIRE(profiler.running() == true);
+
+  profiler.stop();
+  REQUIRE(profiler.running() == false);
+  REQUIRE(profiler.get_backend() == maan::profiling::backend::none);
+}
+
+TEST_CASE("profiler hook samples interpreted code", "[profiler]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto profiler = maan::profiler(vm);
+  REQUIRE(profiler.start({.hook_instructions = 100, .force_hook = true}) == maan::profiling::backend::hook);
+
+  REQUIRE(vm.execute("@busy.lua", busy_code) == 1);
+  vm.pop();
+
+  profiler.stop();
+
+  const auto folded = profiler.folded();
+  REQUIRE(profiler.samples() > 0);
+  REQUIRE(profiler.samples(maan::profiling::category::interpreted) + profiler.dropped() > 0);
+  REQUIRE(folded.starts_with("interpreted"));
+  REQUIRE(folded.find("busy.lua:step") != std::string::npos);
+
+  profiler.reset();
+  REQUIRE(profiler.samples() == 0);
+  REQUIRE(profiler.folded().empty());
+}
+
+TEST_CASE("profiler stops sampling when stopped", "[profiler]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto profiler = maan::profiler(vm);
+  (void)profiler.start({.hook_instructions = 100, .force_hook = true});
+  profiler.stop();
+
+  REQUIRE(vm.execute("@busy.lua", busy_code) == 1);
+  vm.pop();
+
+  REQUIRE(profiler.collect() == 0);
+  REQUIRE(profiler.samples() == 0);
+}
+
+TEST_CASE("only one profiler uses the sampler at a time", "[profiler]") {
+  auto first_vm = maan::vm();
+  auto second_vm = maan::vm();
+
+  auto first = maan::profiler(first_vm);
+  auto second = maan::profiler(second_vm);
+
+  const auto first_backend = first.start();
+  if (first_backend == maan::profiling::backend::sampler) {
+    REQUIRE(second.start() == maan::profiling::backend::hook);
+    second.stop();
+  }
+
+  first.stop();
+  REQUIRE(second.start() == first_backend);
+}
+
+TEST_CASE("profiler sampler splits compiled and gc time", "[profiler]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto profiler = maan::profiler(vm);
+  if (profiler.start({.depth = 8}) != maan::profiling::backend::sampler) {
+    SKIP("luaJIT_profile is not available");
+  }
+
+  REQUIRE(vm.execute("@hot.lua", hot_code) == 1);
+  vm.pop();
+
+  profiler.stop();
+
+  const auto folded = profiler.folded();
+  REQUIRE(profiler.samples() > 0);
+  REQUIRE(profiler.samples(maan::profiling::category::compiled) + profiler.samples(maan::profiling::category::gc) > 0);
+  REQUIRE(is_folded(folded));
+  REQUIRE(folded.find("hot.lua:") != std::string::npos);
+
+  // dumpstack ends every frame with the separator, which never makes it into the profile
+  REQUIRE(folded.find("; ") == std::string::npos);
+  REQUIRE(folded.find(";;") == std::string::npos);
+}
+
+TEST_CASE("profiler hook restores the previous hook", "[profiler]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  REQUIRE(vm.execute("code", "calls = 0 debug.sethook(function() calls = calls + 1 end, '', 10)") == 0);
+  auto* state = vm.get_state();
+  const auto script_hook = lua_gethook(state);
+
+  auto profiler = maan::profiler(vm);
+  REQUIRE(profiler.start({.force_hook = true}) == maan::profiling::backend::hook);
+  REQUIRE(lua_gethook(state) != script_hook);
+
+  profiler.stop();
+  REQUIRE(lua_gethook(state) == script_hook);
+  REQUIRE(lua_gethookmask(state) == LUA_MASKCOUNT);
+  REQUIRE(lua_gethookcount(state) == 10);
+
+  REQUIRE(vm.execute("code", "for i = 1, 100 do end debug.sethook() return calls > 0") == 1);
+  REQUIRE(vm.get<bool>(-1) == true);
+}
+
+TEST_CASE("profiler hook names frames after their chunk", "[profiler]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto profiler = maan::profiler(vm);
+  REQUIRE(profiler.start({.hook_instructions = 100, .force_hook = true}) == maan::profiling::backend::hook);
+
+  REQUIRE(vm.execute("code", busy_code) == 1);
+  vm.pop();
+
+  profiler.stop();
+
+  // chunks loaded from a string are called [string] by luaJIT_profile_dumpstack
+  const auto folded = profiler.folded();
+  REQUIRE(is_folded(folded));
+  REQUIRE(folded.find("[string]:step") != std::string::npos);
+}
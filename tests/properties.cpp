@@ -0,0 +1,65 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct particle {
+  double x = 0.;
+  double y = 0.;
+  int id = 0;
+
+  [[nodiscard]] double get_speed() const {
+    return speed;
+  }
+
+  void set_speed(double value) {
+    speed = value < 0. ? 0. : value;
+  }
+
+  [[nodiscard]] double length() const {
+    return x + y;
+  }
+
+private:
+  double speed = 1.;
+};
+
+template <>
+inline constexpr bool maan::vm_types::by_value<particle> = true;
+
+TEST_CASE("usertype properties", "[usertypes]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.new_usertype<particle>()
+    .property<&particle::x>("x")
+    .property<&particle::y>("y")
+    .readonly_property<&particle::id>("id")
+    .property<&particle::get_speed, &particle::set_speed>("speed")
+    .method("length", &particle::length);
+  REQUIRE(vm.stack_size() == 0);
+
+  auto* value = maan::usertype<particle>::make(vm.get_state());
+  value->id = 7;
+  lua_setglobal(vm.get_state(), "p");
+
+  REQUIRE(vm.execute("code", "p.x = 2 p.y = p.x + 1 p.speed = -5 return p.x, p.y, p.id, p.speed, p:length(), p.missing") == 6);
+  REQUIRE(vm.get<double>(-6) == 2.);
+  REQUIRE(vm.get<double>(-5) == 3.);
+  REQUIRE(vm.get<int>(-4) == 7);
+  REQUIRE(vm.get<double>(-3) == 0.);
+  REQUIRE(vm.get<double>(-2) == 5.);
+  REQUIRE(lua_isnil(vm.get_state(), -1));
+  vm.pop(6);
+
+  REQUIRE(value->x == 2.);
+  REQUIRE(value->y == 3.);
+
+  REQUIRE(vm.execute("code", "p.id = 1") == -1);
+  vm.pop();
+  REQUIRE(vm.execute("code", "p.missing = 1") == -1);
+  vm.pop();
+  REQUIRE(vm.execute("code", "p.x = 'text'") == -1);
+  vm.pop();
+  REQUIRE(value->id == 7);
+  REQUIRE(value->x == 2.);
+}
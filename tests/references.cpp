@@ -0,0 +1,75 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+const auto callback_code = R"(
+return function(a)
+    return a + 1
+end
+)";
+
+TEST_CASE("function references", "[references]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  std::vector<maan::function_reference> callbacks;
+
+  for (auto i = 0; i < 100; ++i) {
+    REQUIRE(vm.execute("callback code", callback_code) == 1);
+    REQUIRE(vm.is<maan::function_reference>(-1) == true);
+
+    callbacks.push_back(vm.get<maan::function_reference>(-1));
+    vm.pop();
+  }
+
+  // references don't occupy any stack slots
+  REQUIRE(vm.stack_size() == 0);
+
+  // destroy out of order
+  callbacks.erase(callbacks.begin() + 10, callbacks.begin() + 50);
+  REQUIRE(callbacks.size() == 60);
+
+  for (const auto& callback : callbacks) {
+    REQUIRE(callback.call(10) == 1);
+    REQUIRE(vm.get<int>(-1) == 11);
+    vm.pop();
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+
+  // freed registry slots are reused
+  const auto freed = callbacks.back().get_ref();
+  callbacks.pop_back();
+
+  vm.push(true);
+  const auto reused = maan::reference(vm.get_state(), -1);
+  vm.pop();
+
+  REQUIRE(reused.get_ref() == freed);
+}
+
+TEST_CASE("table references", "[references]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  lua_newtable(vm.get_state());
+  const auto table = vm.get<maan::table_reference>(-1);
+  vm.pop();
+
+  REQUIRE(vm.stack_size() == 0);
+
+  table.set("value", 100);
+  REQUIRE(vm.stack_size() == 0);
+
+  const auto lambda = [](int value) {
+    REQUIRE(value == 100);
+    return true;
+  };
+
+  REQUIRE(table.map<int>("value", lambda));
+  REQUIRE(vm.stack_size() == 0);
+
+  vm.push(table);
+  REQUIRE(vm.is<maan::table_reference>(-1) == true);
+  vm.pop();
+}
@@ -0,0 +1,72 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct vec3 {
+  float x;
+  float y;
+  float z;
+};
+
+TEST_CASE("stack frame", "[stack]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push(1);
+  REQUIRE(vm.stack_size() == 1);
+
+  {
+    const auto frame = vm.frame(100);
+    REQUIRE(frame.is_reserved() == true);
+    REQUIRE(frame.base() == 1);
+
+    for (auto i = 0; i < 100; ++i) {
+      vm.push(i);
+    }
+
+    REQUIRE(frame.size() == 100);
+    REQUIRE(vm.stack_size() == 101);
+  }
+
+  REQUIRE(vm.stack_size() == 1);
+
+  {
+    auto frame = vm.frame();
+    vm.push(2);
+    frame.release();
+  }
+
+  REQUIRE(vm.stack_size() == 2);
+  vm.pop(2);
+}
+
+TEST_CASE("stack frame with owned values", "[stack]") {
+  auto vm = maan::vm();
+
+  static constexpr std::string_view code = "return function(a) return a end, {}";
+
+  {
+    const auto frame = vm.frame_for<vec3, int>();
+    REQUIRE(frame.is_reserved() == true);
+
+    REQUIRE(vm.execute("code", code) == 2);
+
+    auto table = maan::table(vm.get_state(), -1);
+    auto fn = vm.get<maan::function>(-2);
+
+    // the frame drops both slots at once
+    table.release();
+    fn.release();
+
+    REQUIRE(fn.call(vec3{1.f, 2.f, 3.f}) == 1);
+  }
+
+  REQUIRE(vm.stack_size() == 0);
+}
+
+TEST_CASE("stack frame reservation failure", "[stack]") {
+  auto vm = maan::vm();
+
+  const auto frame = vm.frame(1 << 30);
+  REQUIRE(frame.is_reserved() == false);
+}
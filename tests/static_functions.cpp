@@ -0,0 +1,41 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+namespace {
+int static_add(int a, int b) {
+  return a + b;
+}
+
+std::string static_greet(std::string_view name) {
+  return "hello " + std::string{name};
+}
+} // namespace
+
+TEST_CASE("compile time bound functions", "[functions]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.push<&static_add>();
+  REQUIRE(vm.stack_size() == 1);
+  REQUIRE(lua_getupvalue(vm.get_state(), -1, 1) == nullptr);
+
+  REQUIRE(vm.call(40, 2) == 1);
+  REQUIRE(vm.get<int>(-1) == 42);
+  vm.pop();
+
+  {
+    const auto globals = vm.get_globals();
+    globals.set<&static_add>("add");
+    globals.set<&static_greet>("greet");
+  }
+  REQUIRE(vm.stack_size() == 0);
+
+  REQUIRE(vm.execute("code", "return add(1, 2), greet('lua')") == 2);
+  REQUIRE(vm.get<int>(-2) == 3);
+  REQUIRE(vm.get<std::string>(-1) == "hello lua");
+  vm.pop(2);
+
+  REQUIRE(vm.execute("code", "return add(1)") == -1);
+  vm.pop();
+}
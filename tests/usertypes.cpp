@@ -0,0 +1,83 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+struct counter {
+  static inline int destroyed = 0;
+
+  std::string name;
+  int value = 0;
+
+  counter() = default;
+  counter(std::string name, int value) : name{std::move(name)}, value{value} {}
+  counter(counter const&) = default;
+  counter(counter&&) = default;
+  counter& operator=(counter const&) = default;
+  counter& operator=(counter&&) = default;
+
+  ~counter() {
+    ++destroyed;
+  }
+
+  int add(int amount) {
+    value += amount;
+    return value;
+  }
+
+  [[nodiscard]] std::string get_name() const {
+    return name;
+  }
+};
+
+struct alignas(32) aligned_value {
+  float data[8];
+};
+
+template <>
+inline constexpr bool maan::vm_types::by_value<counter> = true;
+
+template <>
+inline constexpr bool maan::vm_types::by_value<aligned_value> = true;
+
+TEST_CASE("usertype methods", "[usertypes]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  vm.new_usertype<counter>().method("add", &counter::add).method("name", &counter::get_name).meta_method("__tostring", +[](counter* self) -> std::string {
+    return self->name + ":" + std::to_string(self->value);
+  });
+  REQUIRE(vm.stack_size() == 0);
+
+  vm.push(counter{"hits", 1});
+  REQUIRE(vm.stack_size() == 1);
+  REQUIRE(vm.is<counter>(-1) == true);
+  REQUIRE(vm.is<counter*>(-1) == true);
+  REQUIRE(vm.is<aligned_value>(-1) == false);
+  REQUIRE(vm.get<counter>(-1).value == 1);
+
+  lua_setglobal(vm.get_state(), "hits");
+
+  REQUIRE(vm.execute("code", "hits:add(41) return hits:name(), tostring(hits)") == 2);
+  REQUIRE(vm.get<std::string>(-2) == "hits");
+  REQUIRE(vm.get<std::string>(-1) == "hits:42");
+  vm.pop(2);
+}
+
+TEST_CASE("usertype lifetime", "[usertypes]") {
+  auto vm = maan::vm();
+  REQUIRE(vm.running() == true);
+
+  auto* value = maan::usertype<counter>::make(vm.get_state(), "temporary", 5);
+  REQUIRE(value->value == 5);
+  REQUIRE(maan::usertype<counter>::is(vm.get_state(), -1) == true);
+  REQUIRE(&maan::usertype<counter>::get(vm.get_state(), -1) == value);
+
+  const auto destroyed = counter::destroyed;
+  vm.pop();
+  lua_gc(vm.get_state(), LUA_GCCOLLECT, 0);
+  REQUIRE(counter::destroyed == destroyed + 1);
+
+  auto* aligned = maan::usertype<aligned_value>::make(vm.get_state());
+  REQUIRE(reinterpret_cast<std::uintptr_t>(aligned) % alignof(aligned_value) == 0);
+  vm.pop();
+}
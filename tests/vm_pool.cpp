@@ -0,0 +1,74 @@
+#include <catch2/catch_all.hpp>
+
+#include <maan.hpp>
+
+const auto pool_code = R"(
+function transform(a)
+    return a * 3
+end
+)";
+
+TEST_CASE("vm pool", "[pool]") {
+  auto pool = maan::vm_pool(2, [](maan::vm& vm) {
+    REQUIRE(vm.execute("pool code", pool_code) == 0);
+  });
+
+  REQUIRE(pool.size() == 2);
+
+  {
+    auto first = pool.checkout();
+    auto second = pool.checkout();
+
+    REQUIRE(first.slot() != second.slot());
+    REQUIRE(pool.try_checkout().has_value() == false);
+    REQUIRE(pool.get_metrics().in_use == 2);
+    REQUIRE(pool.get_metrics().utilisation() == 1.);
+
+    first->push(1);
+  }
+
+  {
+    // returned vms are reset
+    auto vm = pool.checkout();
+    REQUIRE(vm->stack_size() == 0);
+  }
+
+  const auto metrics = pool.get_metrics();
+  REQUIRE(metrics.in_use == 0);
+  REQUIRE(metrics.peak_in_use == 2);
+  REQUIRE(metrics.checkouts == 3);
+}
+
+TEST_CASE("vm pool across threads", "[pool]") {
+  auto pool = maan::vm_pool(
+    2, [](maan::vm& vm) { REQUIRE(vm.execute("pool code", pool_code) == 0); }, 0);
+
+  std::atomic<int> failures{};
+
+  {
+    std::vector<std::jthread> threads;
+    for (auto t = 0; t < 4; ++t) {
+      threads.emplace_back([&pool, &failures] {
+        for (auto i = 0; i < 250; ++i) {
+          auto vm = pool.checkout();
+
+          const auto globals = vm->get_globals();
+          const auto called = globals.map<maan::function>("transform", [&vm, i](maan::function const& fn) {
+            return fn.call(i) == 1 && vm->get<int>(-1) == i * 3;
+          });
+
+          if (!called) {
+            failures.fetch_add(1);
+          }
+        }
+      });
+    }
+  }
+
+  REQUIRE(failures.load() == 0);
+
+  const auto metrics = pool.get_metrics();
+  REQUIRE(metrics.checkouts == 1000);
+  REQUIRE(metrics.in_use == 0);
+  REQUIRE(metrics.peak_in_use <= 2);
+}